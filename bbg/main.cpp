@@ -2,20 +2,31 @@
 #include <stop_token>
 #include <unordered_map>
 #include <list>
+#include <array>
 #include <filesystem>
 #include <functional>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <jsoncpp/json/json.h>
 #include "logger.hpp"
-#include "reactor.hpp"
 #include "shader.hpp"
+#include "frameUniforms.hpp"
+#include "renderState.hpp"
+#include "indirectRenderer.hpp"
 #include "model.hpp"
 #include "animator.hpp"
-#include "reactor.hpp"
 #include "syncQueue.hpp"
 #include "player.hpp"
 #include "ground.hpp"
+#include "protocol.hpp"
+#include "prediction.hpp"
+#include "netClient.hpp"
+
+// 服务端地址
+#define BBG_SERVER_IP "127.0.0.1"
+#define BBG_SERVER_PORT 6664
+// 单帧最多补跑的模拟tick数，卡顿超过时丢弃积压的时间
+#define MAX_CLIENT_TICK_PER_FRAME 8
 
 /////////////////////////////////////////////////////
 SyncQueue<NetPlayer> npQue;
@@ -27,10 +38,6 @@ int main()
     // mylog::Logger::setOutputFunc(mylog::AsyncHelper::outputFunc_async_file);
     // mylog::Logger::setFlushFunc(mylog::AsyncHelper::flushFunc_async_file);
 
-    Reactor reactor("0.0.0.0", 6664);
-    std::jthread t1([&]
-                    { reactor.run(); });
-
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
@@ -50,46 +57,85 @@ int main()
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     {
         ///////////////////////////////////////////////////////////////////////////////
-        Shader shader_static(std::filesystem::current_path() / "../opengl/glsl/modl_vs.glsl", std::filesystem::current_path() / "../opengl/glsl/modl_fs.glsl");
-        Shader shader_dynamic(std::filesystem::current_path() / "../opengl/glsl/anim_vs.glsl", std::filesystem::current_path() / "../opengl/glsl/anim_fs.glsl");
+        Shader shader_static(std::filesystem::current_path() / "../opengl/glsl/modl_inst_vs.glsl", std::filesystem::current_path() / "../opengl/glsl/modl_fs.glsl");
+        Shader shader_instanced(std::filesystem::current_path() / "../opengl/glsl/anim_inst_vs.glsl", std::filesystem::current_path() / "../opengl/glsl/anim_fs.glsl");
+        Shader shader_cull(std::filesystem::current_path() / "../opengl/glsl/cull_cs.glsl");
+        Shader shader_hiz(std::filesystem::current_path() / "../opengl/glsl/hiz_cs.glsl");
+        FrameUniforms frameUniforms; // view/projection每帧写入一次，所有shader共享
+        HiZBuffer hiZ;               // 上一帧的深度金字塔，静态场景在GPU上据此做遮挡剔除
         Ground ground(std::filesystem::current_path() / "../resources/terrains/boxes/boxes.fbx");
         ground.addCollider("sphere", std::filesystem::current_path() / "../resources/objects/sphere/sphere.fbx");
         ground.addCollider("ring", std::filesystem::current_path() / "../resources/objects/ring/ring.fbx");
         ground.addCollider("cube", std::filesystem::current_path() / "../resources/objects/cube/cube.fbx");
         ground.addCollider("monkey", std::filesystem::current_path() / "../resources/objects/monkey/monkey.fbx");
+        IndirectRenderer staticScene; // 静态模型合批，每帧按材质各一次multi-draw
+        staticScene.add(ground);
+        const int sphereSlot = staticScene.add(ground.getCollider("sphere"), ground.getCollider("sphere").getGlobalMat());
+        staticScene.build();
         ///////////////////////////////////////////////////////////////////////////////
+        std::optional<CryptKey> psk; // 设置了预共享密钥时要求加密
+        CryptKey key;
+        int pskRt = Protocol::presharedKeyFromEnv(key);
+        if (0 == pskRt)
+            psk = key;
+        else if (-1 == pskRt)
+            std::cerr << PSK_ENV_NAME << " is malformed, connecting without encryption" << std::endl;
+        NetClient net(BBG_SERVER_IP, BBG_SERVER_PORT, Player::getInstance().getUUIDv4(), npQue, psk);
+        // 本地玩家按固定步长预测，与服务端对每条输入执行的代码相同
+        const float tickTime = 1.0f / SIMULATION_TICK_RATE;
+        Predictor predictor;
+        auto step = [&ground, tickTime](Body &body, const InputCmd &cmd)
+        {
+            applyInput(body, cmd, tickTime);
+            ground.detectNcorrect(body, tickTime);
+        };
+        double tickAcc = 0.0;
         double deltaTime = 0.0;
         double lastTime = 0.0;
+        std::vector<NetPlayer> netPlayers;              // 每帧与npQue交换，复用容量
+        std::unordered_map<int32_t, glm::mat4> remotes; // 其他玩家最新的权威状态
+        std::unordered_map<int32_t, int> remoteLods;     // 每个玩家上一帧的LOD级别，用于滞回
+        std::array<std::vector<glm::mat4>, LOD_MAX_LEVELS> remoteByLod;
+        std::array<GLsizei, LOD_MAX_LEVELS> remoteLodCounts;
+        std::vector<glm::mat4> remoteMats; // 每帧重用，按级别排列后作为实例化绘制的输入
+        SphereCuller remoteCuller;          // 其他玩家的世界包围球，每帧整批剔除
+        std::vector<uint8_t> remoteVisible;
+#if RENDER_STATE_REPORT
+        double lastReport = 0.0;
+#endif
         while (!glfwWindowShouldClose(window))
         {
             double curTime = glfwGetTime();
             deltaTime = curTime - lastTime;
             lastTime = curTime;
-            Player::getInstance().processKeyboard(window, deltaTime);
+            tickAcc += deltaTime;
+            for (int i = 0; tickAcc >= tickTime; ++i, tickAcc -= tickTime)
+            {
+                if (i == MAX_CLIENT_TICK_PER_FRAME)
+                {
+                    tickAcc = 0.0;
+                    break;
+                }
+                InputCmd cmd;
+                cmd.moves = Player::getInstance().pollMoves(window);
+                cmd.front = Player::getInstance().getFront();
+                cmd.up = Player::getInstance().getUp();
+                cmd.right = Player::getInstance().getRight();
+                if (0 != Protocol::normalizeView(cmd)) // 服务端同样会拒绝，不预测也不发送
+                    continue;
+                net.sendInput_r(predictor.predict(cmd, step));
+            }
+            PlayerSnapshot self;
+            if (0 == net.takeSelf_r(self))
+                predictor.reconcile(self, step);
+            Player::getInstance().setPosition(predictor.getRenderPosition(deltaTime) + glm::vec3(0.0f, VIEW_POS_HEIGHT, 0.0f));
             ground.detectNcorrect(deltaTime); // detect collision and correct it
             glm::mat4 view = Player::getInstance().updateView();
             glm::mat4 projection = Player::getInstance().updateProjection();
+            const Frustum frustum = Frustum::fromMatrix(projection * view);
             glClearColor(0.7f, 0.7f, 0.0f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            auto dynamicShade = [&view, &projection, &deltaTime, &shader_dynamic](Animator &animator, const glm::mat4 &globalMat = glm::mat4(1.0f))
-            {
-                shader_dynamic.use();
-                shader_dynamic.setMat4("model", globalMat);
-                shader_dynamic.setMat4("view", view);
-                shader_dynamic.setMat4("projection", projection);
-                animator.updateAnimation(shader_dynamic, deltaTime);
-            };
-            auto staticShade = [&view, &projection, &shader_static](Model &model, const glm::mat4 &globalMat = glm::mat4(1.0f))
-            {
-                shader_static.use();
-                shader_static.setMat4("model", globalMat);
-                shader_static.setMat4("view", view);
-                shader_static.setMat4("projection", projection);
-                model.draw(shader_static);
-            };
-            ///////////////////////////////////////////////////////////////////////////////
-            staticShade(ground);
-            // dynamicShade(ground.getCollider("cube"));
+            frameUniforms.update(view, projection, Player::getInstance().getPosition());
             if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
                 ground.getCollider("sphere").processPosMove(Movement::FORWARD, deltaTime);
             if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
@@ -103,22 +149,66 @@ int main()
             if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
                 ground.getCollider("sphere").processPosMove(Movement::DOWN, deltaTime);
             ground.getCollider("sphere").setViewMove(Player::getInstance().getGlobalMat());
-            staticShade(ground.getCollider("sphere"), ground.getCollider("sphere").getGlobalMat()); // test
-            while (!npQue.empty_r())
+            staticScene.setTransform(sphereSlot, ground.getCollider("sphere").getGlobalMat()); // test
+            staticScene.drawGpuCulled(shader_static, shader_cull, hiZ);
+            if (!npQue.empty_r() && 0 == npQue.take_r(netPlayers))
+                for (auto &other : netPlayers)
+                    if (other.isLeft)
+                    {
+                        remotes.erase(other.id);
+                        remoteLods.erase(other.id);
+                    }
+                    else if (other.id != net.getId())
+                        remotes.insert_or_assign(other.id, other.globalMat);
+            GLint viewport[4];
+            glGetIntegerv(GL_VIEWPORT, viewport);
+            const float lodScale = LodSelector::lodScale(projection[1][1], static_cast<float>(viewport[3]));
+            Animator &remoteModel = ground.getCollider("ring");
+            for (auto &mats : remoteByLod)
+                mats.clear();
+            remoteCuller.resize(remotes.size());
+            size_t i = 0;
+            for (auto &[id, globalMat] : remotes) // 按绑定姿态的包围球整批剔除视锥外的玩家
+            {
+                glm::vec3 center;
+                float radius;
+                remoteModel.getBounds().transformSphere(globalMat, center, radius);
+                remoteCuller.set(i++, center, radius);
+            }
+            remoteCuller.cull(frustum, remoteVisible);
+            i = 0;
+            for (auto &[id, globalMat] : remotes) // 两次遍历之间remotes未修改，顺序一致；远处的用粗级别
             {
-                NetPlayer other;
-                npQue.take_r(other);
-                dynamicShade(ground.getCollider("ring"), other.globalMat);
+                if (!remoteVisible[i++])
+                    continue;
+                int &lod = remoteLods[id];
+                lod = remoteModel.selectLod(globalMat, Player::getInstance().getPosition(), lodScale, lod);
+                remoteByLod[lod].push_back(globalMat);
             }
+            remoteMats.clear();
+            for (int level = 0; level < LOD_MAX_LEVELS; ++level)
+            {
+                remoteMats.insert(remoteMats.end(), remoteByLod[level].begin(), remoteByLod[level].end());
+                remoteLodCounts[level] = static_cast<GLsizei>(remoteByLod[level].size());
+            }
+            shader_instanced.use();
+            remoteModel.updateAnimationInstanced(shader_instanced, remoteMats, deltaTime, remoteLodCounts);
             ///////////////////////////////////////////////////////////////////////////////
+            hiZ.update(shader_hiz, projection * view);
+            frameUniforms.endFrame();
+#if RENDER_STATE_REPORT
+            if (curTime - lastReport >= 1.0)
+            {
+                std::clog << "GL state: " << GLStateCache::getInstance().getStats() << std::endl;
+                GLStateCache::getInstance().resetStats();
+                lastReport = curTime;
+            }
+#endif
             glfwSwapBuffers(window);
             glfwPollEvents();
         }
     }
     glfwDestroyWindow(window);
     glfwTerminate();
-    reactor.stop();
-    if (t1.joinable())
-        t1.join();
     return 0;
 }
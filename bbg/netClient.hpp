@@ -0,0 +1,168 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include "peer_co.hpp"
+#include "message.hpp"
+#include "syncQueue.hpp"
+#include "syncQueue_lockfree.hpp"
+#include "protocol.hpp"
+#include "player.hpp"
+
+#ifndef NETCLIENT_HPP
+#define NETCLIENT_HPP
+
+// 网络线程检查待发送输入的间隔（ms）
+#define NET_SEND_POLL_INTERVAL 1
+// 断线后重连间隔（ms）
+#define NET_RECONNECT_INTERVAL 1000
+// 主线程 <-> 网络线程队列容量
+#define NET_QUE_SIZE 1024
+
+// 在独立线程中以协程驱动与服务端的连接，主线程只通过无锁队列交换输入与快照
+class NetClient
+{
+    std::string ip_;
+    int port_;
+    Uuid uuid_; // JOIN时上报，服务端据此识别玩家
+    std::optional<CryptKey> psk_; // 非空则要求加密，服务端不同意时断开重连
+    SyncQueue<NetPlayer> &npQue_;                // 其他玩家的状态与离开事件
+    SyncQueue_lockfree<InputCmd> inputQue_;      // 主线程 -> 网络线程
+    SyncQueue_lockfree<PlayerSnapshot> selfQue_; // 网络线程 -> 主线程，本地玩家的权威状态
+    std::atomic<int32_t> id_;
+    std::atomic<bool> is_running_;
+    std::jthread thread_; // 须最后构造、最先析构
+
+public:
+    NetClient(const std::string &ip, int port, const Uuid &uuid, SyncQueue<NetPlayer> &npQue,
+              const std::optional<CryptKey> &psk = std::nullopt)
+        : ip_(ip),
+          port_(port),
+          uuid_(uuid),
+          psk_(psk),
+          npQue_(npQue),
+          inputQue_(NET_QUE_SIZE),
+          selfQue_(NET_QUE_SIZE),
+          id_(-1),
+          is_running_(true),
+          thread_([this]
+                  {
+                      EventLoop loop;
+                      loop.spawn(session(loop));
+                      loop.run(); }) {}
+    ~NetClient()
+    {
+        is_running_ = false;
+        if (thread_.joinable())
+            thread_.join();
+    }
+    NetClient(const NetClient &) = delete;
+    NetClient &operator=(const NetClient &) = delete;
+    NetClient(NetClient &&) = delete;
+    NetClient &operator=(NetClient &&) = delete;
+    int32_t getId() const { return id_.load(std::memory_order_relaxed); }
+    // rt:
+    //   0   sucess
+    //   -1  queue is full, dropped
+    int sendInput_r(const InputCmd &cmd) { return 0 == inputQue_.put_r(cmd) ? 0 : -1; }
+    // 只保留最新的一个
+    // rt:
+    //   0   sucess
+    //   -1  no new snapshot
+    int takeSelf_r(PlayerSnapshot &self)
+    {
+        if (0 != selfQue_.take_r(self))
+            return -1;
+        while (0 == selfQue_.take_r(self))
+            ;
+        return 0;
+    }
+
+private:
+    Task<void> session(EventLoop &loop)
+    {
+        while (is_running_)
+        {
+            auto cli = std::make_shared<Peer_cli_co>(loop);
+            bool ok = co_await cli->conn(ip_, port_);
+            if (ok)
+            {
+                // 多人快照较大，接受服务端压缩
+                int caps = co_await cli->hello(MSG_CAP_LZ | MSG_CAP_CRYPT, psk_ ? &*psk_ : nullptr);
+                ok = -1 != caps && (!psk_ || (caps & MSG_CAP_CRYPT));
+            }
+            if (ok)
+                ok = co_await cli->send(Message::encode(MSG_JOIN, Protocol::encodeUuid(uuid_)));
+            if (!ok)
+            {
+                co_await loop.sleep(std::chrono::milliseconds(NET_RECONNECT_INTERVAL));
+                continue;
+            }
+            loop.spawn(receive(cli));
+            InputCmd cmd;
+            while (is_running_ && cli->isConn())
+            {
+                while (ok && 0 == inputQue_.take_r(cmd))
+                    ok = co_await cli->send(Message::encode(MSG_INPUT, Protocol::encodeInput(cmd)));
+                if (!ok)
+                    break;
+                co_await loop.sleep(std::chrono::milliseconds(NET_SEND_POLL_INTERVAL));
+            }
+            cli->disconn(); // 恢复receive使其退出
+            id_ = -1;
+        }
+    }
+    Task<void> receive(std::shared_ptr<Peer_cli_co> cli)
+    {
+        std::vector<PlayerSnapshot> players;
+        std::string buf; // 解压缓冲，复用容量
+        for (;;)
+        {
+            std::string data = co_await cli->recv();
+            if (data.empty())
+                break;
+            MsgHeader header;
+            std::string_view payload;
+            if (0 != Message::decode(data, header, payload, buf))
+                continue;
+            int32_t id = -1;
+            uint32_t tick = 0;
+            switch (header.type)
+            {
+            case MSG_JOIN:
+                if (0 == Protocol::decodeId(payload, id))
+                    id_ = id;
+                break;
+            case MSG_LEAVE:
+                if (0 == Protocol::decodeId(payload, id))
+                    npQue_.put_r(NetPlayer{.id = id, .isLeft = true});
+                break;
+            case MSG_SNAPSHOT:
+                if (0 != Protocol::decodeSnapshot(payload, tick, players))
+                    break;
+                for (auto &player : players)
+                {
+                    if (player.id == id_.load(std::memory_order_relaxed))
+                    {
+                        selfQue_.put_r(player);
+                        continue;
+                    }
+                    NetPlayer np;
+                    np.id = player.id;
+                    np.globalMat = glm::mat4(glm::vec4(player.right, 0.0f),
+                                             glm::vec4(player.up, 0.0f),
+                                             glm::vec4(player.front, 0.0f),
+                                             glm::vec4(player.position, 1.0f));
+                    npQue_.put_r(std::move(np));
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+};
+
+#endif
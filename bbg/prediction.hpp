@@ -0,0 +1,118 @@
+#include <array>
+#include <cmath>
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include "body.hpp"
+#include "protocol.hpp"
+
+#ifndef PREDICTION_HPP
+#define PREDICTION_HPP
+
+// 预测环形缓冲容量（tick），必须为2的幂且大于最大往返时延对应的tick数
+#define PREDICTION_BUFFER_SIZE 128
+// 纠正后的显示误差超过此距离时直接瞬移，不再平滑
+#define PREDICTION_SNAP_DISTANCE 2.0f
+// 显示误差的指数衰减速率（1/s）
+#define PREDICTION_SMOOTH_RATE 12.0f
+// 预测与服务端位置之差小于此值时视为一致
+#define PREDICTION_EPSILON 1e-3f
+
+// 执行一条输入命令中的转向与移动，服务端与客户端预测共用
+inline void applyInput(Body &body, const InputCmd &cmd, float deltaTime)
+{
+    body.setView(cmd.front, cmd.up, cmd.right);
+    for (int m = 0; m <= static_cast<int>(Movement::DOWN); ++m)
+        if (cmd.hasMove(static_cast<Movement>(m)))
+            body.processPosMove(static_cast<Movement>(m), deltaTime);
+}
+
+// 本地玩家的客户端预测：每条输入立即在本地执行并按seq记入环形缓冲，
+// 收到服务端对某seq的权威状态后，若与当时的预测不符，则从该状态出发重放其后的全部输入，
+// 重放前后的位置差记为显示误差，按指数衰减平滑掉
+// step(Body &, const InputCmd &)须与服务端对每条输入执行的代码一致，且不分配内存
+class Predictor
+{
+    struct Entry
+    {
+        InputCmd cmd;
+        Body state; // 执行cmd之后的状态
+    };
+
+    Body body_;
+    uint32_t seq_;    // 最后一条已预测的输入
+    uint32_t ackSeq_; // 最后一条被服务端确认的输入
+    glm::vec3 errorOffset_;
+    std::array<Entry, PREDICTION_BUFFER_SIZE> ring_;
+
+    static_assert(0 == (PREDICTION_BUFFER_SIZE & (PREDICTION_BUFFER_SIZE - 1)), "PREDICTION_BUFFER_SIZE must be a power of 2");
+
+public:
+    explicit Predictor(const Body &body = Body())
+        : body_(body),
+          seq_(0),
+          ackSeq_(0),
+          errorOffset_(0.0f) {}
+    ~Predictor() = default;
+    Predictor(const Predictor &) = delete;
+    Predictor &operator=(const Predictor &) = delete;
+    Predictor(Predictor &&) = delete;
+    Predictor &operator=(Predictor &&) = delete;
+    Body &getBody() { return body_; }
+    uint32_t getSeq() const { return seq_; }
+    uint32_t getAckSeq() const { return ackSeq_; }
+    uint32_t getPendingNum() const { return seq_ - ackSeq_; }
+    // 分配seq并立即执行，返回值用于发送
+    template <class F>
+    const InputCmd &predict(InputCmd cmd, F &&step)
+    {
+        cmd.seq = ++seq_;
+        step(body_, cmd);
+        Entry &entry = ring_[seq_ & (PREDICTION_BUFFER_SIZE - 1)];
+        entry.cmd = cmd;
+        entry.state = body_;
+        return entry.cmd;
+    }
+    // rt:
+    //   0   prediction matched
+    //   1   corrected and replayed
+    //   -1  stale snapshot, ignored
+    template <class F>
+    int reconcile(const PlayerSnapshot &authority, F &&step)
+    {
+        if (0 == authority.ackSeq || authority.ackSeq <= ackSeq_ || authority.ackSeq > seq_)
+            return -1;
+        ackSeq_ = authority.ackSeq;
+        glm::vec3 before = body_.getPosition();
+        if (seq_ - ackSeq_ >= PREDICTION_BUFFER_SIZE) // 缓冲中已没有该seq，直接采用服务端状态
+        {
+            body_.getPosition() = authority.position;
+            body_.setView(authority.front, authority.up, authority.right);
+            errorOffset_ = glm::vec3(0.0f);
+            return 1;
+        }
+        Entry &acked = ring_[ackSeq_ & (PREDICTION_BUFFER_SIZE - 1)];
+        glm::vec3 diff = acked.state.getPosition() - authority.position;
+        if (glm::dot(diff, diff) < PREDICTION_EPSILON * PREDICTION_EPSILON)
+            return 0;
+        acked.state.getPosition() = authority.position;
+        body_ = acked.state;
+        for (uint32_t seq = ackSeq_ + 1; seq != seq_ + 1; ++seq)
+        {
+            Entry &entry = ring_[seq & (PREDICTION_BUFFER_SIZE - 1)];
+            step(body_, entry.cmd);
+            entry.state = body_;
+        }
+        errorOffset_ += before - body_.getPosition();
+        if (glm::dot(errorOffset_, errorOffset_) > PREDICTION_SNAP_DISTANCE * PREDICTION_SNAP_DISTANCE)
+            errorOffset_ = glm::vec3(0.0f);
+        return 1;
+    }
+    // 每帧调用一次，返回平滑后的显示位置
+    glm::vec3 getRenderPosition(float deltaTime)
+    {
+        errorOffset_ = errorOffset_ * std::exp(-PREDICTION_SMOOTH_RATE * deltaTime);
+        return body_.getPosition() + errorOffset_;
+    }
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <cmath>
+#include <glm/glm.hpp>
+#include "movement.hpp"
+#include "uuid.hpp"
+#include "crypt.hpp"
+
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+// 客户端与服务端共用的游戏消息负载格式，均为小端、紧凑排列
+
+// 模拟频率（Hz），每条输入命令对应一个tick，客户端预测与服务端必须一致
+#define SIMULATION_TICK_RATE 60
+// 加密会话预共享密钥所在的环境变量（64个十六进制字符），服务端与客户端须一致
+#define PSK_ENV_NAME "BBG_PSK"
+
+// 输入命令负载长度（Byte）：seq + moves + front/up/right
+#define INPUT_CMD_SIZE (4 + 1 + 9 * 4)
+// 快照中单个玩家的长度（Byte）：id + ackSeq + position/front/up/right
+#define SNAPSHOT_PLAYER_SIZE (4 + 4 + 12 * 4)
+// 快照头长度（Byte）：tick + count
+#define SNAPSHOT_HEADER_SIZE (4 + 2)
+// 输入朝向长度平方与1之差在此范围内时视为已归一化，原样保留，使归一化可重复执行而结果不变
+#define INPUT_VIEW_UNIT_TOLERANCE 1e-5f
+
+// 一个客户端tick的输入，服务端以固定步长逐条执行
+struct InputCmd
+{
+    uint32_t seq = 0;  // 客户端递增序号，快照中回传已执行到的序号
+    uint8_t moves = 0; // 按位对应Movement
+    glm::vec3 front = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 right = glm::vec3(1.0f, 0.0f, 0.0f);
+
+    void setMove(Movement direction) { moves |= static_cast<uint8_t>(1u << static_cast<int>(direction)); }
+    bool hasMove(Movement direction) const { return moves & (1u << static_cast<int>(direction)); }
+};
+
+struct PlayerSnapshot
+{
+    int32_t id = -1;
+    uint32_t ackSeq = 0; // 该玩家已被服务端执行的最后一条输入
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 front = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 right = glm::vec3(1.0f, 0.0f, 0.0f);
+};
+
+class Protocol
+{
+public:
+    // rt:
+    //   0   sucess
+    //   1   not set
+    //   -1  malformed
+    static int presharedKeyFromEnv(CryptKey &psk)
+    {
+        const char *hex = getenv(PSK_ENV_NAME);
+        if (nullptr == hex)
+            return 1;
+        return 0 == CryptSession::keyFromHex(hex, psk) ? 0 : -1;
+    }
+    static std::string encodeInput(const InputCmd &cmd)
+    {
+        std::string payload;
+        payload.reserve(INPUT_CMD_SIZE);
+        put(payload, cmd.seq);
+        put(payload, cmd.moves);
+        putVec3(payload, cmd.front);
+        putVec3(payload, cmd.up);
+        putVec3(payload, cmd.right);
+        return payload;
+    }
+    // rt:
+    //   0   sucess
+    //   -1  malformed
+    static int decodeInput(std::string_view payload, InputCmd &cmd)
+    {
+        if (payload.size() != INPUT_CMD_SIZE)
+            return -1;
+        const char *p = payload.data();
+        get(p, cmd.seq);
+        get(p, cmd.moves);
+        getVec3(p, cmd.front);
+        getVec3(p, cmd.up);
+        getVec3(p, cmd.right);
+        return normalizeView(cmd);
+    }
+    // 把front/up/right归一化，移动速度不随客户端发来的向量长度变化；客户端预测前也须调用，与服务端解码后的结果逐位一致
+    // rt:
+    //   0   sucess
+    //   -1  non-finite or zero-length vector
+    static int normalizeView(InputCmd &cmd)
+    {
+        for (glm::vec3 *v : {&cmd.front, &cmd.up, &cmd.right})
+        {
+            float len2 = glm::dot(*v, *v);
+            if (!std::isfinite(v->x) || !std::isfinite(v->y) || !std::isfinite(v->z) || !std::isfinite(len2) || len2 < 1e-12f)
+                return -1;
+            if (fabsf(len2 - 1.0f) > INPUT_VIEW_UNIT_TOLERANCE)
+                *v /= sqrtf(len2);
+        }
+        return 0;
+    }
+    // 清空payload并写入快照头，之后逐个appendSnapshot
+    static void beginSnapshot(std::string &payload, uint32_t tick)
+    {
+        payload.clear();
+        put(payload, tick);
+        put(payload, static_cast<uint16_t>(0));
+    }
+    static void appendSnapshot(std::string &payload, const PlayerSnapshot &player)
+    {
+        uint16_t count = 0;
+        memcpy(&count, payload.data() + 4, sizeof(count));
+        ++count;
+        memcpy(payload.data() + 4, &count, sizeof(count));
+        put(payload, player.id);
+        put(payload, player.ackSeq);
+        putVec3(payload, player.position);
+        putVec3(payload, player.front);
+        putVec3(payload, player.up);
+        putVec3(payload, player.right);
+    }
+    // players被清空后填入
+    // rt:
+    //   0   sucess
+    //   -1  malformed
+    static int decodeSnapshot(std::string_view payload, uint32_t &tick, std::vector<PlayerSnapshot> &players)
+    {
+        players.clear();
+        if (payload.size() < SNAPSHOT_HEADER_SIZE)
+            return -1;
+        const char *p = payload.data();
+        uint16_t count = 0;
+        get(p, tick);
+        get(p, count);
+        if (payload.size() != SNAPSHOT_HEADER_SIZE + static_cast<size_t>(count) * SNAPSHOT_PLAYER_SIZE)
+            return -1;
+        players.resize(count);
+        for (auto &player : players)
+        {
+            get(p, player.id);
+            get(p, player.ackSeq);
+            getVec3(p, player.position);
+            getVec3(p, player.front);
+            getVec3(p, player.up);
+            getVec3(p, player.right);
+        }
+        return 0;
+    }
+    // MSG_JOIN请求的负载为客户端的uuid
+    static std::string encodeUuid(const Uuid &id)
+    {
+        std::string payload;
+        payload.reserve(UUID_BYTE_SIZE);
+        put(payload, id.hi);
+        put(payload, id.lo);
+        return payload;
+    }
+    // rt:
+    //   0   sucess
+    //   -1  malformed
+    static int decodeUuid(std::string_view payload, Uuid &id)
+    {
+        if (payload.size() != UUID_BYTE_SIZE)
+            return -1;
+        const char *p = payload.data();
+        get(p, id.hi);
+        get(p, id.lo);
+        return 0;
+    }
+    // MSG_JOIN回复与MSG_LEAVE的负载均为玩家的会话id
+    static std::string encodeId(int32_t id)
+    {
+        std::string payload;
+        put(payload, id);
+        return payload;
+    }
+    // rt:
+    //   0   sucess
+    //   -1  malformed
+    static int decodeId(std::string_view payload, int32_t &id)
+    {
+        if (payload.size() != sizeof(id))
+            return -1;
+        const char *p = payload.data();
+        get(p, id);
+        return 0;
+    }
+
+private:
+    template <class T>
+    static void put(std::string &buf, T value) { buf.append(reinterpret_cast<const char *>(&value), sizeof(T)); }
+    template <class T>
+    static void get(const char *&p, T &value)
+    {
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+    }
+    static void putVec3(std::string &buf, const glm::vec3 &v)
+    {
+        put(buf, v.x);
+        put(buf, v.y);
+        put(buf, v.z);
+    }
+    static void getVec3(const char *&p, glm::vec3 &v)
+    {
+        get(p, v.x);
+        get(p, v.y);
+        get(p, v.z);
+    }
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <filesystem>
+#include <signal.h>
+#include "reactor.hpp"
+#include "syncQueue_lockfree.hpp"
+#include "ground.hpp"
+#include "body.hpp"
+#include "protocol.hpp"
+#include "prediction.hpp"
+#include "tickScheduler.hpp"
+#include "sessionTable.hpp"
+#include "serverHandlers.hpp"
+
+// 无头专用服务端，编译时需定义BBG_HEADLESS，不创建任何GL资源
+
+// 服务端模拟频率（Hz）
+#define SERVER_TICK_RATE SIMULATION_TICK_RATE
+// 服务端监听端口
+#define SERVER_PORT 6664
+// 每隔多少个tick广播一次快照
+#define SNAPSHOT_TICK_INTERVAL 2
+// 单个玩家缓存的未执行输入上限，超过则丢弃最旧的
+#define MAX_PENDING_INPUT_NUM 8
+// 单个玩家每tick最多执行的输入数，积压时借此追赶
+#define MAX_INPUT_PER_TICK 2
+// 玩家多少个tick没有输入后移除（兜底处理丢失的离开事件）
+#define PLAYER_IDLE_TICKS (SERVER_TICK_RATE * 30)
+// 单帧快照最多包含的玩家数，超过则分多帧发送
+#define SNAPSHOT_MAX_PLAYER_NUM ((MAX_FRAME_SIZE - MSG_HEADER_SIZE - 1 - SNAPSHOT_HEADER_SIZE) / SNAPSHOT_PLAYER_SIZE)
+
+// 以会话id为下标存放
+struct ServerPlayer
+{
+    Uuid uuid;
+    bool joined = false; // JOIN之后、LEAVE之前
+    int32_t slot = -1;   // 在活跃列表中的下标，-1表示因空闲被移出
+    Body body;
+    std::deque<InputCmd> inputs;
+    uint32_t ackSeq = 0;
+    uint64_t lastInputTick = 0;
+};
+
+/////////////////////////////////////////////////////
+TickScheduler scheduler(SERVER_TICK_RATE);
+/////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    // bbg_server [port] [capture file]
+    int port = argc > 1 ? std::stoi(argv[1]) : SERVER_PORT;
+    std::string capturePath = argc > 2 ? argv[2] : "";
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, [](int)
+           { scheduler.stop(); });
+    signal(SIGTERM, [](int)
+           { scheduler.stop(); });
+
+    // 只加载地形：玩家的模拟只与地面碰撞，客户端的碰撞体不影响任何权威状态
+    Ground ground(std::filesystem::current_path() / "../resources/terrains/boxes/boxes.fbx");
+
+    registerServerHandlers();
+
+    Reactor reactor("0.0.0.0", port, WORKER_THREAD_NUM, capturePath);
+    CryptKey psk;
+    int pskRt = Protocol::presharedKeyFromEnv(psk);
+    if (-1 == pskRt)
+    {
+        std::cerr << PSK_ENV_NAME << " must be " << 2 * CRYPT_KEY_SIZE << " hex characters" << std::endl;
+        return 1;
+    }
+    if (0 == pskRt) // 配置了密钥即要求所有客户端加密
+        reactor.setPresharedKey(psk, true);
+    std::jthread t1([&]
+                    { reactor.run(); });
+    std::clog << "bbg_server listening on " << port << ", tick rate " << SERVER_TICK_RATE << "Hz" << std::endl;
+    if (!capturePath.empty())
+        std::clog << "capturing received frames to " << capturePath << std::endl;
+
+    std::vector<ServerPlayer> players(MAX_SESSION_NUM);
+    std::vector<int32_t> active; // 参与模拟与快照的会话id，紧凑排列
+    auto activate = [&](int32_t id)
+    {
+        players[id].slot = static_cast<int32_t>(active.size());
+        active.push_back(id);
+    };
+    // 与末尾交换后删除，不保持顺序
+    auto deactivate = [&](int32_t id)
+    {
+        int32_t slot = players[id].slot;
+        players[active.back()].slot = slot;
+        active[slot] = active.back();
+        active.pop_back();
+        players[id].slot = -1;
+        reactor.broadcast_r(MSG_LEAVE, Protocol::encodeId(id));
+    };
+    std::deque<InputEvent> events;
+    std::string snapshot;
+    const float deltaTime = scheduler.getDeltaTime();
+    scheduler.run([&](uint64_t tick)
+                  {
+                      events.clear();
+                      inputQue.take_r(events);
+                      for (auto &ev : events)
+                      {
+                          ServerPlayer &player = players[ev.id];
+                          switch (ev.type)
+                          {
+                          case InputEvent::JOIN:
+                              if (player.joined)
+                                  break;
+                              player = ServerPlayer();
+                              player.uuid = ev.uuid;
+                              player.joined = true;
+                              player.lastInputTick = tick;
+                              activate(ev.id);
+                              std::clog << "A player joined, id: " << ev.id << ", uuid: " << ev.uuid.toString() << std::endl;
+                              break;
+                          case InputEvent::LEAVE:
+                              if (-1 != player.slot)
+                                  deactivate(ev.id);
+                              player.joined = false;
+                              sessions.release_r(ev.id);
+                              break;
+                          case InputEvent::INPUT:
+                              if (!player.joined)
+                                  break;
+                              if (-1 == player.slot)
+                                  activate(ev.id);
+                              player.lastInputTick = tick;
+                              player.inputs.push_back(ev.cmd);
+                              if (player.inputs.size() > MAX_PENDING_INPUT_NUM)
+                                  player.inputs.pop_front();
+                              break;
+                          }
+                      }
+                      for (size_t i = 0; i < active.size();)
+                      {
+                          int32_t id = active[i];
+                          ServerPlayer &player = players[id];
+                          if (tick - player.lastInputTick > PLAYER_IDLE_TICKS)
+                          {
+                              deactivate(id); // 会话id保留到连接关闭，再有输入时重新加入
+                              continue;
+                          }
+                          // 每条输入对应一次固定步长的模拟，与客户端预测逐条一致；没有输入时不推进
+                          int budget = player.inputs.size() > MAX_INPUT_PER_TICK ? MAX_INPUT_PER_TICK : 1;
+                          for (; budget > 0 && !player.inputs.empty(); --budget)
+                          {
+                              applyInput(player.body, player.inputs.front(), deltaTime);
+                              ground.detectNcorrect(player.body, deltaTime);
+                              player.ackSeq = player.inputs.front().seq;
+                              player.inputs.pop_front();
+                          }
+                          ++i;
+                      }
+                      if (0 != tick % SNAPSHOT_TICK_INTERVAL || active.empty())
+                          return;
+                      // 单帧时可合并，慢客户端只收最新快照；分帧时每帧都须送达
+                      bool coalesce = active.size() <= SNAPSHOT_MAX_PLAYER_NUM;
+                      size_t inFrame = 0;
+                      Protocol::beginSnapshot(snapshot, static_cast<uint32_t>(tick));
+                      for (int32_t id : active)
+                      {
+                          const ServerPlayer &player = players[id];
+                          PlayerSnapshot ps;
+                          ps.id = id;
+                          ps.ackSeq = player.ackSeq;
+                          ps.position = player.body.getPosition();
+                          ps.front = player.body.getFront();
+                          ps.up = player.body.getUp();
+                          ps.right = player.body.getRight();
+                          Protocol::appendSnapshot(snapshot, ps);
+                          if (++inFrame == SNAPSHOT_MAX_PLAYER_NUM)
+                          {
+                              reactor.broadcast_r(MSG_SNAPSHOT, snapshot, coalesce);
+                              Protocol::beginSnapshot(snapshot, static_cast<uint32_t>(tick));
+                              inFrame = 0;
+                          }
+                      }
+                      if (inFrame > 0)
+                          reactor.broadcast_r(MSG_SNAPSHOT, snapshot, coalesce); });
+
+    reactor.stop();
+    if (t1.joinable())
+        t1.join();
+    std::clog << "bbg_server exit" << std::endl;
+    return 0;
+}
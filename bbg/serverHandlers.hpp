@@ -0,0 +1,80 @@
+#include <iostream>
+#include <thread>
+#include <string_view>
+#include <stdint.h>
+#include "reactor.hpp"
+#include "syncQueue_lockfree.hpp"
+#include "protocol.hpp"
+#include "sessionTable.hpp"
+
+#ifndef SERVERHANDLERS_HPP
+#define SERVERHANDLERS_HPP
+
+// 输入队列容量，满时Handler延后该帧
+#define INPUT_QUE_SIZE 16384
+
+// Handler线程 -> tick线程
+struct InputEvent
+{
+    enum Type : uint8_t
+    {
+        INPUT,
+        JOIN,
+        LEAVE // 连接已关闭，处理后归还会话id
+    };
+    Type type = INPUT;
+    int32_t id = -1; // 会话id
+    InputCmd cmd;
+    Uuid uuid; // 仅JOIN
+};
+
+/////////////////////////////////////////////////////
+inline SyncQueue_lockfree<InputEvent> inputQue(INPUT_QUE_SIZE);
+inline SessionTable sessions;
+/////////////////////////////////////////////////////
+
+// bbg_server的消息处理，bbg_replay回放抓包时复用；必须在构造Reactor之前调用
+// 输入与加入只做解码和入队，由取inputQue的一方统一执行，LEAVE处理完后须sessions.release_r归还会话id
+inline void registerServerHandlers()
+{
+    // 玩家状态由服务端按输入模拟后下发，不再转发客户端自报的状态；回显也不开放，两者与未知类型一样丢弃
+    Handler::registerHandler(MSG_PLAYER_STATE, nullptr);
+    Handler::registerHandler(MSG_ECHO, nullptr);
+    // 输入只做解码和入队，由tick线程统一执行
+    Handler::registerHandler(MSG_INPUT, [](Session &session, std::string_view payload)
+                             {
+                                 InputEvent ev;
+                                 ev.id = sessions.find_r(session.getFd());
+                                 if (-1 == ev.id || 0 != Protocol::decodeInput(payload, ev.cmd))
+                                     return 0;
+                                 return 0 == inputQue.put_r(std::move(ev)) ? 0 : 1; });
+    // 分配会话id并回复，重复JOIN返回同一id
+    Handler::registerHandler(MSG_JOIN, [](Session &session, std::string_view payload)
+                             {
+                                 InputEvent ev;
+                                 ev.type = InputEvent::JOIN;
+                                 if (0 != Protocol::decodeUuid(payload, ev.uuid))
+                                     return -1;
+                                 ev.id = sessions.bind_r(session.getFd());
+                                 if (-1 == ev.id)
+                                 {
+                                     std::cerr << "bbg_server is full, fd: " << session.getFd() << std::endl;
+                                     return -1;
+                                 }
+                                 if (0 != inputQue.put_r(ev))
+                                     return 1;
+                                 session.reply(MSG_JOIN, Protocol::encodeId(ev.id));
+                                 return 0; });
+    // 离开事件不可丢，与输入走同一队列以保证先后顺序
+    Handler::registerCloseHandler([](int fd)
+                                  {
+                                      InputEvent ev;
+                                      ev.type = InputEvent::LEAVE;
+                                      ev.id = sessions.unbind_r(fd);
+                                      if (-1 == ev.id)
+                                          return;
+                                      while (-1 == inputQue.put_r(ev))
+                                          std::this_thread::yield(); });
+}
+
+#endif
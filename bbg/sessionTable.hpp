@@ -0,0 +1,80 @@
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include "syncQueue_lockfree.hpp"
+#include "reactor.hpp"
+
+#ifndef SESSIONTABLE_HPP
+#define SESSIONTABLE_HPP
+
+// 最大同时在线玩家数，会话id取值[0, MAX_SESSION_NUM)
+#define MAX_SESSION_NUM MAX_CONNECTION_NUM
+// fd -> 会话id映射表大小，fd超出时拒绝加入
+#define MAX_SESSION_FD (MAX_SESSION_NUM + 1024)
+
+// 为每个连接分配稠密的小整数会话id，玩家状态可直接以id为下标存放在数组中
+// bind/find/unbind在Handler线程中按fd调用；id只在使用方处理完离开事件后release，避免被提前复用
+class SessionTable
+{
+    SyncQueue_lockfree<int32_t> freeIds_;
+    std::unique_ptr<std::atomic<int32_t>[]> fdToId_;
+
+public:
+    SessionTable()
+        : freeIds_(MAX_SESSION_NUM),
+          fdToId_(std::make_unique<std::atomic<int32_t>[]>(MAX_SESSION_FD))
+    {
+        for (int32_t id = 0; id < MAX_SESSION_NUM; ++id)
+            freeIds_.put_r(id);
+        for (int fd = 0; fd < MAX_SESSION_FD; ++fd)
+            fdToId_[fd].store(-1, std::memory_order_relaxed);
+    }
+    ~SessionTable()
+    {
+        int32_t id;
+        while (0 == freeIds_.take_r(id)) // 空闲id不是遗留数据，避免析构时被报告
+            ;
+    }
+    SessionTable(const SessionTable &) = delete;
+    SessionTable &operator=(const SessionTable &) = delete;
+    SessionTable(SessionTable &&) = delete;
+    SessionTable &operator=(SessionTable &&) = delete;
+    // 已绑定时返回原id
+    // rt:
+    //   >=0 session id
+    //   -1  no free id or fd out of range
+    int32_t bind_r(int fd)
+    {
+        if (fd < 0 || fd >= MAX_SESSION_FD)
+            return -1;
+        int32_t id = fdToId_[fd].load(std::memory_order_acquire);
+        if (-1 != id)
+            return id;
+        if (0 != freeIds_.take_r(id))
+            return -1;
+        fdToId_[fd].store(id, std::memory_order_release);
+        return id;
+    }
+    // rt:
+    //   >=0 session id
+    //   -1  not bound
+    int32_t find_r(int fd) const
+    {
+        if (fd < 0 || fd >= MAX_SESSION_FD)
+            return -1;
+        return fdToId_[fd].load(std::memory_order_acquire);
+    }
+    // 连接关闭时调用（须在fd被close之前），解绑但不归还id
+    // rt:
+    //   >=0 session id
+    //   -1  not bound
+    int32_t unbind_r(int fd)
+    {
+        if (fd < 0 || fd >= MAX_SESSION_FD)
+            return -1;
+        return fdToId_[fd].exchange(-1, std::memory_order_acq_rel);
+    }
+    void release_r(int32_t id) { freeIds_.put_r(id); }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <stdint.h>
+#include <sys/prctl.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#ifndef TICKSCHEDULER_HPP
+#define TICKSCHEDULER_HPP
+
+// 距离deadline多久时停止睡眠改为自旋（us），覆盖内核定时器唤醒误差
+#define TICK_SPIN_MARGIN_US 1000
+// 每隔多少个tick输出一次抖动统计，0表示不输出
+#define TICK_REPORT_INTERVAL 600
+
+// 固定频率的tick调度器：deadline按绝对时间推进（不累积漂移），先睡到deadline前TICK_SPIN_MARGIN_US，再自旋到deadline
+// 某tick超时超过一个周期时丢弃错过的tick并重新对齐，不补跑
+class TickScheduler
+{
+    using Clock = std::chrono::steady_clock;
+
+    int rate_;
+    Clock::duration interval_;
+    std::atomic<bool> is_running_;
+    uint64_t tick_;
+    uint64_t overruns_;
+    Clock::duration maxJitter_;
+    Clock::duration sumJitter_;
+    uint64_t jitterCount_;
+
+public:
+    explicit TickScheduler(int rate)
+        : rate_(std::max(rate, 1)),
+          interval_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate_))),
+          is_running_(false),
+          tick_(0),
+          overruns_(0),
+          maxJitter_(0),
+          sumJitter_(0),
+          jitterCount_(0) {}
+    ~TickScheduler() = default;
+    TickScheduler(const TickScheduler &) = delete;
+    TickScheduler &operator=(const TickScheduler &) = delete;
+    TickScheduler(TickScheduler &&) = delete;
+    TickScheduler &operator=(TickScheduler &&) = delete;
+    int getRate() const { return rate_; }
+    float getDeltaTime() const { return 1.0f / rate_; }
+    uint64_t getTick() const { return tick_; }
+    uint64_t getOverruns() const { return overruns_; }
+    // 可在任意线程调用，当前tick结束后返回
+    void stop() { is_running_ = false; }
+    // 阻塞运行，每个tick调用一次onTick(tick)
+    template <class F>
+    void run(F &&onTick)
+    {
+        prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0); // 默认50us的定时器松弛会放大睡眠误差
+        is_running_ = true;
+        auto deadline = Clock::now();
+        while (is_running_)
+        {
+            onTick(tick_++);
+            deadline += interval_;
+            auto now = Clock::now();
+            if (now >= deadline + interval_)
+            {
+                ++overruns_;
+                deadline = now;
+                continue;
+            }
+            waitUntil(deadline);
+            recordJitter(Clock::now() - deadline);
+        }
+    }
+
+private:
+    static void waitUntil(Clock::time_point deadline)
+    {
+        auto margin = std::chrono::microseconds(TICK_SPIN_MARGIN_US);
+        if (deadline - Clock::now() > margin)
+            std::this_thread::sleep_until(deadline - margin);
+        while (Clock::now() < deadline)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+        }
+    }
+    void recordJitter(Clock::duration jitter)
+    {
+        maxJitter_ = std::max(maxJitter_, jitter);
+        sumJitter_ += jitter;
+        if (0 == TICK_REPORT_INTERVAL || ++jitterCount_ < TICK_REPORT_INTERVAL)
+            return;
+        using us = std::chrono::duration<double, std::micro>;
+        std::clog << "tick " << tick_
+                  << ", jitter mean " << us(sumJitter_).count() / jitterCount_
+                  << "us, max " << us(maxJitter_).count()
+                  << "us, overruns " << overruns_ << std::endl;
+        maxJitter_ = Clock::duration(0);
+        sumJitter_ = Clock::duration(0);
+        jitterCount_ = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include <vector>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+#ifndef HDRHISTOGRAM_HPP
+#define HDRHISTOGRAM_HPP
+
+// 高动态范围直方图（HdrHistogram的对数-线性分桶），在[lowest, highest]内保持sigDigits位有效数字
+// 记录O(1)，内存与数值范围的对数成正比，不可跨线程同时写，多线程各自记录后merge
+class HdrHistogram
+{
+    int64_t lowest_;
+    int64_t highest_;
+    int unitMagnitude_;
+    int subBucketHalfCountMagnitude_;
+    int64_t subBucketCount_;
+    int64_t subBucketHalfCount_;
+    int64_t subBucketMask_;
+    int bucketCount_;
+    std::vector<int64_t> counts_;
+    int64_t totalCount_;
+    int64_t min_;
+    int64_t max_;
+    double sum_;
+
+public:
+    explicit HdrHistogram(int64_t lowest = 1, int64_t highest = 60LL * 1000 * 1000, int sigDigits = 3)
+        : lowest_(lowest < 1 ? 1 : lowest),
+          highest_(highest),
+          totalCount_(0),
+          min_(INT64_MAX),
+          max_(0),
+          sum_(0.0)
+    {
+        if (sigDigits < 1)
+            sigDigits = 1;
+        if (sigDigits > 5)
+            sigDigits = 5;
+        if (highest_ < 2 * lowest_)
+            highest_ = 2 * lowest_;
+        int64_t largestSingleUnit = 2 * static_cast<int64_t>(std::pow(10, sigDigits));
+        int subBucketCountMagnitude = static_cast<int>(std::ceil(std::log2(static_cast<double>(largestSingleUnit))));
+        subBucketHalfCountMagnitude_ = (subBucketCountMagnitude > 1 ? subBucketCountMagnitude : 1) - 1;
+        unitMagnitude_ = static_cast<int>(std::floor(std::log2(static_cast<double>(lowest_))));
+        subBucketCount_ = 1LL << (subBucketHalfCountMagnitude_ + 1);
+        subBucketHalfCount_ = subBucketCount_ / 2;
+        subBucketMask_ = (subBucketCount_ - 1) << unitMagnitude_;
+        int64_t smallestUntrackable = subBucketCount_ << unitMagnitude_;
+        bucketCount_ = 1;
+        while (smallestUntrackable <= highest_)
+        {
+            if (smallestUntrackable > INT64_MAX / 2)
+            {
+                ++bucketCount_;
+                break;
+            }
+            smallestUntrackable <<= 1;
+            ++bucketCount_;
+        }
+        counts_.assign((bucketCount_ + 1) * subBucketHalfCount_, 0);
+    }
+    ~HdrHistogram() = default;
+    HdrHistogram(const HdrHistogram &) = default;
+    HdrHistogram &operator=(const HdrHistogram &) = default;
+    HdrHistogram(HdrHistogram &&) = default;
+    HdrHistogram &operator=(HdrHistogram &&) = default;
+    // 超出范围的值截断到边界
+    void record(int64_t value, int64_t count = 1)
+    {
+        value = std::clamp(value, lowest_, highest_);
+        counts_[countsIndex(value)] += count;
+        totalCount_ += count;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+        sum_ += static_cast<double>(value) * count;
+    }
+    // 两个直方图参数必须相同
+    void merge(const HdrHistogram &other)
+    {
+        if (other.counts_.size() != counts_.size() || other.unitMagnitude_ != unitMagnitude_)
+            return;
+        for (size_t i = 0; i < counts_.size(); ++i)
+            counts_[i] += other.counts_[i];
+        totalCount_ += other.totalCount_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        sum_ += other.sum_;
+    }
+    void reset()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        totalCount_ = 0;
+        min_ = INT64_MAX;
+        max_ = 0;
+        sum_ = 0.0;
+    }
+    int64_t count() const { return totalCount_; }
+    int64_t min() const { return totalCount_ ? min_ : 0; }
+    int64_t max() const { return max_; }
+    double mean() const { return totalCount_ ? sum_ / totalCount_ : 0.0; }
+    // percentile取值[0, 100]，返回落在该百分位的桶的最大等价值
+    int64_t valueAtPercentile(double percentile) const
+    {
+        if (0 == totalCount_)
+            return 0;
+        percentile = std::clamp(percentile, 0.0, 100.0);
+        int64_t target = static_cast<int64_t>(std::ceil(percentile / 100.0 * totalCount_));
+        if (target < 1)
+            target = 1;
+        int64_t acc = 0;
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            acc += counts_[i];
+            if (acc >= target)
+                return std::min(highestEquivalentValue(static_cast<int>(i)), max_);
+        }
+        return max_;
+    }
+    // 按HdrHistogram惯例输出百分位分布表
+    void print(std::ostream &os, const char *unit = "us") const
+    {
+        static const double percentiles[] = {0.0, 50.0, 75.0, 90.0, 99.0, 99.9, 99.99, 100.0};
+        os << std::right << std::setw(12) << "percentile" << std::setw(14) << unit << std::endl;
+        for (double p : percentiles)
+            os << std::setw(12) << std::fixed << std::setprecision(3) << p
+               << std::setw(14) << valueAtPercentile(p) << std::endl;
+        os << "#[count = " << totalCount_ << ", mean = " << std::setprecision(2) << mean()
+           << ", max = " << max_ << "]" << std::endl;
+    }
+
+private:
+    int countsIndex(int64_t value) const
+    {
+        int pow2Ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | subBucketMask_));
+        int bucketIndex = pow2Ceiling - unitMagnitude_ - (subBucketHalfCountMagnitude_ + 1);
+        int64_t subBucketIndex = value >> (bucketIndex + unitMagnitude_);
+        return static_cast<int>(((static_cast<int64_t>(bucketIndex) + 1) << subBucketHalfCountMagnitude_) + (subBucketIndex - subBucketHalfCount_));
+    }
+    int64_t highestEquivalentValue(int index) const
+    {
+        int bucketIndex = (index >> subBucketHalfCountMagnitude_) - 1;
+        int64_t subBucketIndex = (index & (subBucketHalfCount_ - 1)) + subBucketHalfCount_;
+        if (bucketIndex < 0)
+        {
+            subBucketIndex -= subBucketHalfCount_;
+            bucketIndex = 0;
+        }
+        int64_t lowestEquivalent = subBucketIndex << (bucketIndex + unitMagnitude_);
+        return lowestEquivalent + (1LL << (bucketIndex + unitMagnitude_)) - 1;
+    }
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <getopt.h>
+#include <sys/resource.h>
+#include "peer_co.hpp"
+#include "message.hpp"
+#include "reactor.hpp"
+#include "hdrHistogram.hpp"
+#include "uuid.hpp"
+
+// NetPlayer形状的负载：发送时间戳(ns) + 二进制uuid + mat4，其后填充到指定长度
+#define LOADGEN_UUID_SIZE UUID_BYTE_SIZE
+#define LOADGEN_MAT_SIZE (16 * sizeof(float))
+#define LOADGEN_MIN_PAYLOAD_SIZE (sizeof(int64_t) + LOADGEN_UUID_SIZE + LOADGEN_MAT_SIZE)
+// 停止发送后等待回包的最长时间（ms）
+#define LOADGEN_DRAIN_TIME 2000
+
+struct LoadgenConfig
+{
+    std::string ip = "127.0.0.1";
+    int port = 6664;
+    int connNum = 1000;
+    double connRate = 500.0; // 每秒新建连接数
+    size_t msgSize = LOADGEN_MIN_PAYLOAD_SIZE;
+    double tickHz = 20.0; // 每个连接每秒发送的更新数
+    int duration = 10;    // 发送时长（s）
+    int threadNum = 1;    // 每个线程一个EventLoop，连接平均分配
+    bool embed = false;   // 进程内启动Reactor，方便单机自测
+    bool compress = false; // 连接后以MSG_HELLO协商压缩，回显负载达到阈值时由服务端压缩
+    bool encrypt = false;  // 连接后以MSG_HELLO协商加密
+    CryptKey psk{};
+};
+
+struct LoadgenStats
+{
+    HdrHistogram rtt{1, 60LL * 1000 * 1000, 3}; // 往返时延（us）
+    long long connected = 0;
+    long long connFailed = 0;
+    long long sent = 0;
+    long long received = 0;
+    long long bytes = 0;
+};
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string makePayload(const LoadgenConfig &cfg, int id)
+{
+    std::string payload(cfg.msgSize, '\0');
+    Uuid uuid;
+    uuid.lo = static_cast<uint64_t>(id);
+    memcpy(payload.data() + sizeof(int64_t), &uuid, LOADGEN_UUID_SIZE);
+    float mat[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, static_cast<float>(id), 0, 0, 1};
+    memcpy(payload.data() + sizeof(int64_t) + LOADGEN_UUID_SIZE, mat, LOADGEN_MAT_SIZE);
+    return payload;
+}
+
+// 收到回显后以计划发送时间计算时延，避免发送被拖慢时漏计排队时间（coordinated omission）
+static Task<void> recvLoop(std::shared_ptr<Peer_cli_co> cli, LoadgenStats &stats)
+{
+    std::string buf;
+    for (;;)
+    {
+        std::string data = co_await cli->recv();
+        if (data.empty())
+            break;
+        MsgHeader header;
+        std::string_view payload;
+        if (0 != Message::decode(data, header, payload, buf) || MSG_ECHO != header.type || payload.size() < sizeof(int64_t))
+            continue;
+        int64_t sendTime = 0;
+        memcpy(&sendTime, payload.data(), sizeof(int64_t));
+        stats.rtt.record((nowNs() - sendTime) / 1000);
+        ++stats.received;
+        stats.bytes += data.size() + 4;
+    }
+}
+
+static Task<void> clientLoop(EventLoop &loop, const LoadgenConfig &cfg, LoadgenStats &stats, int id,
+                             std::chrono::steady_clock::time_point connAt, std::chrono::steady_clock::time_point stopAt)
+{
+    co_await loop.sleepUntil(connAt);
+    auto cli = std::make_shared<Peer_cli_co>(loop);
+    bool ok = co_await cli->conn(cfg.ip, cfg.port);
+    if (!ok)
+    {
+        ++stats.connFailed;
+        co_return;
+    }
+    if (cfg.compress || cfg.encrypt)
+    {
+        uint8_t want = (cfg.compress ? MSG_CAP_LZ : 0) | (cfg.encrypt ? MSG_CAP_CRYPT : 0);
+        int caps = co_await cli->hello(want, cfg.encrypt ? &cfg.psk : nullptr);
+        ok = caps == want;
+    }
+    if (!ok)
+    {
+        ++stats.connFailed;
+        co_return;
+    }
+    ++stats.connected;
+    loop.spawn(recvLoop(cli, stats));
+    std::string payload = makePayload(cfg, id);
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / cfg.tickHz));
+    auto next = std::chrono::steady_clock::now();
+    while (next < stopAt && cli->isConn())
+    {
+        co_await loop.sleepUntil(next);
+        int64_t sendTime = std::chrono::duration_cast<std::chrono::nanoseconds>(next.time_since_epoch()).count();
+        memcpy(payload.data(), &sendTime, sizeof(int64_t));
+        bool sent = co_await cli->send(Message::encode(MSG_ECHO, payload));
+        if (!sent)
+            break;
+        ++stats.sent;
+        next += period;
+    }
+    co_await loop.sleepUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(LOADGEN_DRAIN_TIME));
+    cli->disconn(); // 恢复recvLoop使其退出
+}
+
+static void usage(const char *prog)
+{
+    std::cerr << "usage: " << prog << " [options]\n"
+              << "  -a ip        server ip (127.0.0.1)\n"
+              << "  -p port      server port (6664)\n"
+              << "  -n num       connections (1000)\n"
+              << "  -r rate      new connections per second (500)\n"
+              << "  -s size      payload bytes, at least " << LOADGEN_MIN_PAYLOAD_SIZE << "\n"
+              << "  -t hz        updates per connection per second (20)\n"
+              << "  -d sec       sending duration (10)\n"
+              << "  -j threads   event loop threads (1)\n"
+              << "  -e           run an in-process Reactor on the port\n"
+              << "  -z           negotiate compression of echoed payloads\n"
+              << "  -k hexkey    encrypt with a 32-byte pre-shared key (64 hex chars)" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    LoadgenConfig cfg;
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "a:p:n:r:s:t:d:j:ezk:h")))
+    {
+        switch (opt)
+        {
+        case 'a':
+            cfg.ip = optarg;
+            break;
+        case 'p':
+            cfg.port = std::stoi(optarg);
+            break;
+        case 'n':
+            cfg.connNum = std::stoi(optarg);
+            break;
+        case 'r':
+            cfg.connRate = std::stod(optarg);
+            break;
+        case 's':
+            cfg.msgSize = std::stoul(optarg);
+            break;
+        case 't':
+            cfg.tickHz = std::stod(optarg);
+            break;
+        case 'd':
+            cfg.duration = std::stoi(optarg);
+            break;
+        case 'j':
+            cfg.threadNum = std::stoi(optarg);
+            break;
+        case 'e':
+            cfg.embed = true;
+            break;
+        case 'z':
+            cfg.compress = true;
+            break;
+        case 'k':
+            if (0 != CryptSession::keyFromHex(optarg, cfg.psk))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            cfg.encrypt = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    cfg.msgSize = std::clamp<size_t>(cfg.msgSize, LOADGEN_MIN_PAYLOAD_SIZE, MAX_FRAME_SIZE - MSG_HEADER_SIZE - 1);
+    cfg.connNum = std::max(cfg.connNum, 1);
+    cfg.connRate = std::max(cfg.connRate, 1.0);
+    cfg.tickHz = std::max(cfg.tickHz, 0.1);
+    cfg.threadNum = std::clamp(cfg.threadNum, 1, cfg.connNum);
+
+    rlimit lim{};
+    if (0 == getrlimit(RLIMIT_NOFILE, &lim) && lim.rlim_cur < lim.rlim_max)
+    {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+    if (lim.rlim_cur < static_cast<rlim_t>(cfg.connNum) * (cfg.embed ? 2 : 1) + 64)
+        std::cerr << "warning: RLIMIT_NOFILE " << lim.rlim_cur << " is too small for " << cfg.connNum << " connections" << std::endl;
+
+    std::unique_ptr<Reactor> reactor;
+    std::jthread reactorThread;
+    if (cfg.embed)
+    {
+        std::clog.rdbuf(nullptr); // 屏蔽Reactor每个连接的日志
+        reactor = std::make_unique<Reactor>(cfg.ip, cfg.port);
+        if (cfg.encrypt)
+            reactor->setPresharedKey(cfg.psk);
+        reactorThread = std::jthread([&reactor]
+                                     { reactor->run(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    std::vector<LoadgenStats> stats(cfg.threadNum);
+    auto start = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+    auto rampTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(cfg.connNum / cfg.connRate));
+    auto stopAt = start + rampTime + std::chrono::seconds(cfg.duration);
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(cfg.threadNum);
+        for (int t = 0; t < cfg.threadNum; ++t)
+            threads.emplace_back([&, t]
+                                 {
+                                     EventLoop loop;
+                                     for (int i = t; i < cfg.connNum; i += cfg.threadNum)
+                                     {
+                                         auto connAt = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(i / cfg.connRate));
+                                         loop.spawn(clientLoop(loop, cfg, stats[t], i, connAt, stopAt));
+                                     }
+                                     loop.run(); });
+    }
+    double sec = std::chrono::duration<double>(stopAt - start).count(); // 含建连爬坡阶段
+
+    if (cfg.embed)
+    {
+        reactor->stop();
+        reactorThread.join();
+        reactor.reset();
+    }
+
+    LoadgenStats total;
+    for (auto &s : stats)
+    {
+        total.rtt.merge(s.rtt);
+        total.connected += s.connected;
+        total.connFailed += s.connFailed;
+        total.sent += s.sent;
+        total.received += s.received;
+        total.bytes += s.bytes;
+    }
+    std::cout << "connections: " << total.connected << " ok, " << total.connFailed << " failed" << std::endl;
+    std::cout << "messages:    " << total.sent << " sent, " << total.received << " received" << std::endl;
+    std::cout << std::fixed << std::setprecision(2)
+              << "throughput:  " << total.received / sec << " msg/s, "
+              << total.bytes / sec / (1024 * 1024) << " MiB/s" << std::endl;
+    std::cout << "rtt:         p50 " << total.rtt.valueAtPercentile(50.0)
+              << " us, p99 " << total.rtt.valueAtPercentile(99.0)
+              << " us, p999 " << total.rtt.valueAtPercentile(99.9) << " us" << std::endl;
+    total.rtt.print(std::cout);
+    return 0;
+}
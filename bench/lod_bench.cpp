@@ -0,0 +1,110 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <math.h>
+#include "lod.hpp"
+
+// LOD链生成：每级三角形数、误差（相对包围盒对角线）与耗时；起伏地形网格、UV球（经线接缝与两极为重合顶点）
+
+struct BenchVertex
+{
+    struct
+    {
+        float x, y, z;
+    } position;
+};
+
+struct BenchMesh
+{
+    const char *name;
+    std::vector<BenchVertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+static BenchMesh makeTerrain(const char *name, int n)
+{
+    BenchMesh mesh{name, {}, {}};
+    for (int z = 0; z <= n; ++z)
+        for (int x = 0; x <= n; ++x)
+            mesh.vertices.push_back({{static_cast<float>(x), 4.0f * sinf(x * 0.05f) * cosf(z * 0.07f) + 0.5f * sinf(x * 0.3f + z * 0.2f), static_cast<float>(z)}});
+    for (int z = 0; z < n; ++z)
+        for (int x = 0; x < n; ++x)
+        {
+            unsigned int a = z * (n + 1) + x;
+            unsigned int b = a + 1;
+            unsigned int c = a + (n + 1);
+            unsigned int d = c + 1;
+            mesh.indices.insert(mesh.indices.end(), {a, c, b, b, c, d});
+        }
+    return mesh;
+}
+
+static BenchMesh makeSphere(const char *name, int rings, int segments)
+{
+    BenchMesh mesh{name, {}, {}};
+    for (int r = 0; r <= rings; ++r)
+        for (int s = 0; s <= segments; ++s)
+        {
+            float phi = 3.14159265f * r / rings;
+            float theta = 6.28318531f * s / segments;
+            mesh.vertices.push_back({{sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta)}});
+        }
+    for (int r = 0; r < rings; ++r)
+        for (int s = 0; s < segments; ++s)
+        {
+            unsigned int a = r * (segments + 1) + s;
+            unsigned int b = a + segments + 1;
+            if (r != 0)
+                mesh.indices.insert(mesh.indices.end(), {a, b, a + 1});
+            if (r != rings - 1)
+                mesh.indices.insert(mesh.indices.end(), {a + 1, b, b + 1});
+        }
+    return mesh;
+}
+
+// 索引越界或退化三角形（两个下标相同）
+static bool valid(const std::vector<unsigned int> &indices, size_t first, size_t num, size_t vertexNum)
+{
+    for (size_t t = first; t + 2 < first + num; t += 3)
+    {
+        unsigned int a = indices[t], b = indices[t + 1], c = indices[t + 2];
+        if (a >= vertexNum || b >= vertexNum || c >= vertexNum || a == b || b == c || a == c)
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    std::vector<BenchMesh> meshes;
+    meshes.push_back(makeTerrain("terrain", 256));
+    meshes.push_back(makeSphere("sphere", 128, 256));
+
+    std::cout << std::left << std::setw(10) << "mesh" << std::right << std::setw(7) << "level"
+              << std::setw(10) << "tris" << std::setw(9) << "ratio" << std::setw(12) << "rel error"
+              << std::setw(10) << "build ms" << std::endl;
+    std::cout << std::fixed;
+    for (auto &mesh : meshes)
+    {
+        std::vector<unsigned int> lodIndices;
+        std::vector<LodLevel> levels;
+        auto start = std::chrono::steady_clock::now();
+        LodBuilder::build(mesh.vertices, mesh.indices, lodIndices, levels);
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::vector<unsigned int> all = mesh.indices;
+        all.insert(all.end(), lodIndices.begin(), lodIndices.end());
+        float extent = LodBuilder::extent(mesh.vertices);
+        for (size_t i = 0; i < levels.size(); ++i)
+        {
+            if (!valid(all, levels[i].firstIndex, levels[i].indexNum, mesh.vertices.size()))
+                std::cerr << mesh.name << ": level " << i << " has invalid triangles" << std::endl;
+            std::cout << std::left << std::setw(10) << mesh.name << std::right << std::setw(7) << i
+                      << std::setw(10) << levels[i].indexNum / 3
+                      << std::setprecision(3) << std::setw(9) << static_cast<double>(levels[i].indexNum) / levels[0].indexNum
+                      << std::setprecision(5) << std::setw(12) << levels[i].error / extent
+                      << std::setprecision(1) << std::setw(10) << (0 == i ? sec * 1e3 : 0.0) << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <string.h>
+#include "lz.hpp"
+#include "message.hpp"
+
+// 每个用例至少运行的时间（s）
+#define BENCH_MIN_TIME 0.05
+
+// 压缩率与CPU开销的权衡：每种负载在不同长度下的压缩比、压缩/解压吞吐量，以及每微秒CPU换来的字节数
+
+static std::string makeSnapshot(size_t size, std::mt19937 &gen)
+{
+    // 快照形状：tick + count，之后每个玩家id + ackSeq + 位置 + 三个单位向量
+    std::uniform_real_distribution<float> pos(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::string data;
+    uint32_t tick = 12345;
+    uint16_t count = 0;
+    data.append(reinterpret_cast<const char *>(&tick), 4);
+    data.append(reinterpret_cast<const char *>(&count), 2);
+    for (int32_t id = 0; data.size() < size; ++id)
+    {
+        uint32_t ackSeq = 1000 + id;
+        float yaw = angle(gen);
+        float v[12] = {pos(gen), 0.0f, pos(gen),
+                       std::cos(yaw), 0.0f, std::sin(yaw),
+                       0.0f, 1.0f, 0.0f,
+                       -std::sin(yaw), 0.0f, std::cos(yaw)};
+        data.append(reinterpret_cast<const char *>(&id), 4);
+        data.append(reinterpret_cast<const char *>(&ackSeq), 4);
+        data.append(reinterpret_cast<const char *>(v), sizeof(v));
+    }
+    data.resize(size);
+    return data;
+}
+
+static std::string makeText(size_t size, std::mt19937 &gen)
+{
+    // 关卡状态一类的文本：结构重复、数值变化
+    std::uniform_int_distribution<int> num(0, 9999);
+    std::string data;
+    for (int i = 0; data.size() < size; ++i)
+        data += "{\"id\":" + std::to_string(i) + ",\"type\":\"crate\",\"pos\":[" + std::to_string(num(gen)) + "," +
+                std::to_string(num(gen)) + "," + std::to_string(num(gen)) + "],\"hp\":100},";
+    data.resize(size);
+    return data;
+}
+
+static std::string makeRandom(size_t size, std::mt19937 &gen)
+{
+    std::string data(size, '\0');
+    for (auto &c : data)
+        c = static_cast<char>(gen());
+    return data;
+}
+
+template <class F>
+static double timeIt(F &&f, long long &iters)
+{
+    iters = 0;
+    auto start = std::chrono::steady_clock::now();
+    double sec = 0.0;
+    do
+    {
+        for (int i = 0; i < 64; ++i)
+            f();
+        iters += 64;
+        sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (sec < BENCH_MIN_TIME);
+    return sec / iters;
+}
+
+int main()
+{
+    std::mt19937 gen(42);
+    const size_t sizes[] = {64, 256, 1024, 4096, 16384, 65536};
+    struct Kind
+    {
+        const char *name;
+        std::string (*make)(size_t, std::mt19937 &);
+    } kinds[] = {{"snapshot", makeSnapshot}, {"text", makeText}, {"random", makeRandom}};
+
+    std::cout << std::left << std::setw(10) << "payload" << std::right
+              << std::setw(8) << "bytes" << std::setw(9) << "packed" << std::setw(8) << "ratio"
+              << std::setw(12) << "comp MB/s" << std::setw(12) << "deco MB/s"
+              << std::setw(11) << "comp ns" << std::setw(11) << "deco ns"
+              << std::setw(13) << "saved B/us" << std::setw(8) << "sent" << std::endl;
+    std::cout << std::fixed;
+    for (auto &kind : kinds)
+        for (size_t size : sizes)
+        {
+            std::string src = kind.make(size, gen);
+            std::string packed;
+            std::string out;
+            long long iters = 0;
+            double comp = timeIt([&]
+                                 { packed.clear(); Lz::compress(src, packed); }, iters);
+            double deco = timeIt([&]
+                                 { Lz::decompress(packed, out, src.size()); }, iters);
+            if (out != src)
+                std::cerr << kind.name << " " << size << ": round trip mismatch" << std::endl;
+            // 与Message::compress相同的取舍：太小或压缩后不更短则原样发送
+            std::string msg = Message::encode(MSG_SNAPSHOT, src);
+            std::string packedMsg;
+            bool sentPacked = 0 == Message::compress(msg, packedMsg);
+            double saved = static_cast<double>(src.size()) - static_cast<double>(packed.size());
+            std::cout << std::left << std::setw(10) << kind.name << std::right
+                      << std::setw(8) << src.size() << std::setw(9) << packed.size()
+                      << std::setprecision(2) << std::setw(8) << static_cast<double>(src.size()) / packed.size()
+                      << std::setprecision(0) << std::setw(12) << src.size() / comp / 1e6
+                      << std::setw(12) << src.size() / deco / 1e6
+                      << std::setw(11) << comp * 1e9 << std::setw(11) << deco * 1e9
+                      << std::setprecision(1) << std::setw(13) << saved / ((comp + deco) * 1e6)
+                      << std::setw(8) << (sentPacked ? "lz" : "raw") << std::endl;
+        }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "syncQueue_nonblocking.hpp"
+#include "syncQueue_lockfree.hpp"
+
+// 每个生产者投递的元素个数
+#define BENCH_ITEMS_PER_PRODUCER 1000000
+
+// 多生产者多消费者争用下的吞吐量，put_r/take_r失败时自旋重试
+template <class Queue>
+double runContention(Queue &que, int producerNum, int consumerNum)
+{
+    std::atomic<long long> consumed = 0;
+    std::atomic<long long> checksum = 0;
+    const long long total = static_cast<long long>(producerNum) * BENCH_ITEMS_PER_PRODUCER;
+    std::vector<std::thread> threads;
+    threads.reserve(producerNum + consumerNum);
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < producerNum; ++p)
+        threads.emplace_back([&que]
+                             {
+                                 for (int i = 1; i <= BENCH_ITEMS_PER_PRODUCER; ++i)
+                                     while (0 != que.put_r(i))
+                                         std::this_thread::yield(); });
+    for (int c = 0; c < consumerNum; ++c)
+        threads.emplace_back([&que, &consumed, &checksum, total]
+                             {
+                                 long long sum = 0;
+                                 int element = 0;
+                                 while (consumed.load(std::memory_order_relaxed) < total)
+                                 {
+                                     if (0 == que.take_r(element))
+                                     {
+                                         sum += element;
+                                         consumed.fetch_add(1, std::memory_order_relaxed);
+                                     }
+                                     else
+                                         std::this_thread::yield();
+                                 }
+                                 checksum += sum; });
+    for (auto &t : threads)
+        t.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const long long expect = static_cast<long long>(producerNum) * BENCH_ITEMS_PER_PRODUCER * (BENCH_ITEMS_PER_PRODUCER + 1LL) / 2;
+    if (checksum != expect)
+        std::cerr << "checksum mismatch: " << checksum << " != " << expect << std::endl;
+    return total / sec;
+}
+
+int main(int argc, char *argv[])
+{
+    int maxThreads = argc > 1 ? std::stoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency() / 2);
+    if (maxThreads < 1)
+        maxThreads = 1;
+    std::cout << std::left << std::setw(16) << "producers"
+              << std::setw(16) << "consumers"
+              << std::setw(20) << "mutex (Mops/s)"
+              << std::setw(20) << "lockfree (Mops/s)" << std::endl;
+    for (int n = 1; n <= maxThreads; n *= 2)
+    {
+        double mtx, lf;
+        {
+            SyncQueue_nonblocking<int> que;
+            mtx = runContention(que, n, n);
+        }
+        {
+            SyncQueue_lockfree<int> que(MAX_QUE_SIZE);
+            lf = runContention(que, n, n);
+        }
+        std::cout << std::left << std::setw(16) << n
+                  << std::setw(16) << n
+                  << std::setw(20) << std::fixed << std::setprecision(2) << mtx / 1e6
+                  << std::setw(20) << lf / 1e6 << std::endl;
+    }
+    return 0;
+}
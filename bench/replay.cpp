@@ -0,0 +1,325 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <getopt.h>
+#include "peer_co.hpp"
+#include "message.hpp"
+#include "reactor.hpp"
+#include "capture.hpp"
+#include "hdrHistogram.hpp"
+#include "serverHandlers.hpp"
+
+// 回放Reactor抓包日志（见capture.hpp），用于复现线上流量做确定性的性能分析：
+//   默认在进程内按记录顺序直接调用Handler（注册与bbg_server相同的处理函数），不经过网络，统计每帧处理耗时
+//   指定-p时按原连接数建立TCP连接，把每帧按时间发往Reactor（如bbg_server），统计发送相对计划时间的延迟
+//   服务端配置了BBG_PSK时须用-k提供同一密钥，每条连接先协商加密再回放
+
+struct ReplayConfig
+{
+    std::string file;
+    std::string ip = "127.0.0.1";
+    int port = -1;       // 小于0时直接调用Handler
+    double speed = 1.0;  // 回放倍速，0表示不等待、尽快回放
+    bool embed = false;  // 进程内启动Reactor，方便单机自测
+    bool encrypt = false; // 网络模式下以MSG_HELLO协商加密
+    CryptKey psk{};
+};
+
+struct ReplayStats
+{
+    HdrHistogram latency{1, 60LL * 1000 * 1000 * 1000, 3}; // Handler模式为处理耗时（ns），网络模式为发送延迟（us）
+    long long frames = 0;
+    long long heartbeats = 0;
+    long long hellos = 0; // Handler模式下跳过，由Reactor处理
+    long long connFailed = 0;
+    long long received = 0;
+    long long rt[4] = {}; // Handler::process返回值0、1、-1、-2的次数
+};
+
+using Clock = std::chrono::steady_clock;
+
+static Clock::time_point scheduleAt(const ReplayConfig &cfg, Clock::time_point start, uint64_t timeNs)
+{
+    if (cfg.speed <= 0.0)
+        return start;
+    return start + std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(timeNs) / cfg.speed);
+}
+
+static void waitUntil(Clock::time_point deadline)
+{
+    if (deadline > Clock::now())
+        std::this_thread::sleep_until(deadline);
+}
+
+// 连接号映射为从0起复用的小整数作为fd传给Handler（SessionTable按fd直接寻址），关闭事件交给registerCloseHandler注册的回调
+// 处理函数放入inputQue的事件在计时区间外取出丢弃，LEAVE归还会话id，与bbg_server的tick线程相同
+static void replayHandler(const ReplayConfig &cfg, const std::vector<CaptureRecord> &records, ReplayStats &stats)
+{
+    Handler handler;
+    std::vector<Outgoing> out;
+    std::deque<InputEvent> events;
+    std::unordered_map<uint32_t, int> fds;
+    std::vector<int> freeFds;
+    int nextFd = 0;
+    auto start = Clock::now();
+    for (auto &record : records)
+    {
+        waitUntil(scheduleAt(cfg, start, record.timeNs));
+        auto it = fds.find(record.conn);
+        if (fds.end() == it)
+        {
+            int fd = nextFd;
+            if (freeFds.empty())
+                ++nextFd;
+            else
+            {
+                fd = freeFds.back();
+                freeFds.pop_back();
+            }
+            it = fds.emplace(record.conn, fd).first;
+        }
+        int fd = it->second;
+        if (CaptureRecord::CLOSE == record.kind)
+        {
+            handler.onClose(fd);
+            freeFds.push_back(fd);
+            fds.erase(it);
+        }
+        else if (CaptureRecord::FRAME == record.kind)
+        {
+            if (1 == record.data.size())
+                ++stats.heartbeats;
+            else if (MSG_HELLO == static_cast<uint8_t>(record.data[0]))
+                ++stats.hellos;
+            else
+            {
+                out.clear();
+                auto t0 = Clock::now();
+                int rt = handler.process(fd, record.data, out);
+                stats.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+                ++stats.frames;
+                ++stats.rt[rt >= 0 ? rt : 1 - rt];
+            }
+        }
+        events.clear();
+        inputQue.take_r(events);
+        for (auto &ev : events)
+            if (InputEvent::LEAVE == ev.type)
+                sessions.release_r(ev.id);
+    }
+}
+
+// 记录的data末尾带'\0'
+static bool isHello(const std::string &data)
+{
+    return data.size() > MSG_HEADER_SIZE + 1 && MSG_HELLO == static_cast<uint8_t>(data[0]);
+}
+
+static Task<void> drainLoop(std::shared_ptr<Peer_cli_co> cli, ReplayStats &stats)
+{
+    for (;;)
+    {
+        std::string data = co_await cli->recv();
+        if (data.empty())
+            break;
+        ++stats.received;
+    }
+}
+
+// 一个抓包连接对应一条TCP连接，记录的data末尾带'\0'，发送时由send重新补上
+static Task<void> connLoop(EventLoop &loop, const ReplayConfig &cfg, std::vector<const CaptureRecord *> records,
+                           Clock::time_point start, ReplayStats &stats)
+{
+    co_await loop.sleepUntil(scheduleAt(cfg, start, records.front()->timeNs));
+    auto cli = std::make_shared<Peer_cli_co>(loop);
+    bool ok = co_await cli->conn(cfg.ip, cfg.port);
+    if (!ok)
+    {
+        ++stats.connFailed;
+        co_return;
+    }
+    // 抓包为解密后的明文：要求加密时用-k的密钥重新协商，代替抓包中的MSG_HELLO；否则去掉其中的加密能力位
+    const CaptureRecord *hello = nullptr;
+    if (cfg.encrypt)
+    {
+        uint8_t caps = MSG_CAP_CRYPT;
+        for (auto record : records)
+            if (CaptureRecord::FRAME == record->kind)
+            {
+                if (isHello(record->data))
+                {
+                    hello = record;
+                    caps |= static_cast<uint8_t>(record->data[MSG_HEADER_SIZE]);
+                }
+                break;
+            }
+        int granted = co_await cli->hello(caps, &cfg.psk);
+        if (granted < 0 || !(granted & MSG_CAP_CRYPT))
+        {
+            ++stats.connFailed;
+            cli->disconn();
+            co_return;
+        }
+    }
+    loop.spawn(drainLoop(cli, stats));
+    for (auto record : records)
+    {
+        if (CaptureRecord::FRAME != record->kind || record == hello)
+            continue;
+        auto at = scheduleAt(cfg, start, record->timeNs);
+        co_await loop.sleepUntil(at);
+        std::string data(record->data, 0, record->data.empty() ? 0 : record->data.size() - 1);
+        if (isHello(record->data))
+            data = Message::encode(MSG_HELLO, std::string(1, static_cast<char>(data[MSG_HEADER_SIZE] & ~MSG_CAP_CRYPT)));
+        bool sent = co_await cli->send(std::move(data));
+        if (!sent)
+            break;
+        stats.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - at).count());
+        if (1 == record->data.size())
+            ++stats.heartbeats;
+        else
+            ++stats.frames;
+    }
+    co_await loop.sleep(std::chrono::milliseconds(100)); // 等待最后的回复
+    cli->disconn(); // 恢复drainLoop使其退出
+}
+
+static void replayNetwork(const ReplayConfig &cfg, const std::vector<CaptureRecord> &records, ReplayStats &stats)
+{
+    std::map<uint32_t, std::vector<const CaptureRecord *>> conns;
+    for (auto &record : records)
+        conns[record.conn].push_back(&record);
+    EventLoop loop;
+    auto start = Clock::now() + std::chrono::milliseconds(10);
+    for (auto &conn : conns)
+        loop.spawn(connLoop(loop, cfg, std::move(conn.second), start, stats));
+    loop.run();
+}
+
+static void usage(const char *prog)
+{
+    std::cerr << "usage: " << prog << " -f file [options]\n"
+              << "  -f file      capture log written by Reactor\n"
+              << "  -x speed     replay speed factor, 0 for as fast as possible (1)\n"
+              << "  -a ip        server ip (127.0.0.1)\n"
+              << "  -p port      replay over TCP to a Reactor instead of calling Handler directly\n"
+              << "  -e           run an in-process Reactor on the port\n"
+              << "  -k hexkey    encrypt with a 32-byte pre-shared key (64 hex chars), as set by BBG_PSK" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    ReplayConfig cfg;
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "f:x:a:p:ek:h")))
+    {
+        switch (opt)
+        {
+        case 'f':
+            cfg.file = optarg;
+            break;
+        case 'x':
+            cfg.speed = std::stod(optarg);
+            break;
+        case 'a':
+            cfg.ip = optarg;
+            break;
+        case 'p':
+            cfg.port = std::stoi(optarg);
+            break;
+        case 'e':
+            cfg.embed = true;
+            break;
+        case 'k':
+            if (0 != CryptSession::keyFromHex(optarg, cfg.psk))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            cfg.encrypt = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.file.empty() || (cfg.embed && cfg.port < 0))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<CaptureRecord> records;
+    int rt = CaptureReader::load(cfg.file, records);
+    if (0 != rt)
+    {
+        std::cerr << cfg.file << (-1 == rt ? ": open failed" : ": not a capture file") << std::endl;
+        return 1;
+    }
+    if (records.empty())
+    {
+        std::cerr << cfg.file << ": no records" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<Reactor> reactor;
+    std::jthread reactorThread;
+    if (cfg.embed)
+    {
+        std::clog.rdbuf(nullptr); // 屏蔽Reactor每个连接的日志
+        reactor = std::make_unique<Reactor>(cfg.ip, cfg.port);
+        if (cfg.encrypt)
+            reactor->setPresharedKey(cfg.psk, true);
+        reactorThread = std::jthread([&reactor]
+                                     { reactor->run(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    if (cfg.port < 0)
+        registerServerHandlers();
+    ReplayStats stats;
+    auto start = Clock::now();
+    if (cfg.port < 0)
+        replayHandler(cfg, records, stats);
+    else
+        replayNetwork(cfg, records, stats);
+    double sec = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (cfg.embed)
+    {
+        reactor->stop();
+        reactorThread.join();
+        reactor.reset();
+    }
+
+    double captured = records.back().timeNs / 1e9;
+    std::cout << "records:     " << records.size() << ", captured over " << std::fixed << std::setprecision(3) << captured << " s" << std::endl;
+    std::cout << "frames:      " << stats.frames << " replayed, " << stats.heartbeats << " heartbeats in " << sec << " s, "
+              << std::setprecision(0) << stats.frames / sec << " frame/s" << std::endl;
+    if (cfg.port < 0)
+    {
+        std::cout << "hello:       " << stats.hellos << " skipped (handled by Reactor)" << std::endl;
+        std::cout << "handler rt:  " << stats.rt[0] << " handled, " << stats.rt[1] << " deferred, "
+                  << stats.rt[2] << " closed, " << stats.rt[3] << " malformed" << std::endl;
+        std::cout << "process:     p50 " << stats.latency.valueAtPercentile(50.0)
+                  << " ns, p99 " << stats.latency.valueAtPercentile(99.0)
+                  << " ns, max " << stats.latency.max() << " ns" << std::endl;
+        stats.latency.print(std::cout, "ns");
+    }
+    else
+    {
+        std::cout << "connections: " << stats.connFailed << " failed, " << stats.received << " frames received" << std::endl;
+        std::cout << "send lag:    p50 " << stats.latency.valueAtPercentile(50.0)
+                  << " us, p99 " << stats.latency.valueAtPercentile(99.0)
+                  << " us, max " << stats.latency.max() << " us" << std::endl;
+        stats.latency.print(std::cout);
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <math.h>
+#include "vertexCache.hpp"
+
+// 顶点缓存优化前后的ACMR/ATVR与耗时：规则网格地形（导出器常见的逐行顺序）、三角形乱序的同一网格、UV球
+
+struct BenchVertex
+{
+    struct
+    {
+        float x, y, z;
+    } position;
+};
+
+struct BenchMesh
+{
+    const char *name;
+    std::vector<BenchVertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+static BenchMesh makeGrid(const char *name, int n, bool shuffle)
+{
+    BenchMesh mesh{name, {}, {}};
+    for (int z = 0; z <= n; ++z)
+        for (int x = 0; x <= n; ++x)
+            mesh.vertices.push_back({{static_cast<float>(x), sinf(x * 0.1f) * cosf(z * 0.1f), static_cast<float>(z)}});
+    std::vector<std::array<unsigned int, 3>> tris;
+    for (int z = 0; z < n; ++z)
+        for (int x = 0; x < n; ++x)
+        {
+            unsigned int a = z * (n + 1) + x;
+            unsigned int b = a + 1;
+            unsigned int c = a + (n + 1);
+            unsigned int d = c + 1;
+            tris.push_back({a, c, b});
+            tris.push_back({b, c, d});
+        }
+    if (shuffle)
+        std::shuffle(tris.begin(), tris.end(), std::mt19937(42));
+    for (auto &t : tris)
+        mesh.indices.insert(mesh.indices.end(), t.begin(), t.end());
+    return mesh;
+}
+
+static BenchMesh makeSphere(const char *name, int rings, int segments)
+{
+    BenchMesh mesh{name, {}, {}};
+    for (int r = 0; r <= rings; ++r)
+        for (int s = 0; s <= segments; ++s)
+        {
+            float phi = 3.14159265f * r / rings;
+            float theta = 6.28318531f * s / segments;
+            mesh.vertices.push_back({{sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta)}});
+        }
+    for (int r = 0; r < rings; ++r)
+        for (int s = 0; s < segments; ++s)
+        {
+            unsigned int a = r * (segments + 1) + s;
+            unsigned int b = a + segments + 1;
+            mesh.indices.insert(mesh.indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    return mesh;
+}
+
+// 优化只能改变顺序：按位置比较三角形集合（重排后顶点下标不同）
+static bool sameTriangles(const BenchMesh &l, const BenchMesh &r)
+{
+    auto key = [](const BenchMesh &m)
+    {
+        std::vector<std::array<float, 9>> tris;
+        for (size_t t = 0; t + 2 < m.indices.size(); t += 3)
+        {
+            std::array<std::array<float, 3>, 3> v;
+            for (int k = 0; k < 3; ++k)
+            {
+                auto &p = m.vertices[m.indices[t + k]].position;
+                v[k] = {p.x, p.y, p.z};
+            }
+            std::rotate(v.begin(), std::min_element(v.begin(), v.end()), v.end()); // 保持绕序
+            tris.push_back({v[0][0], v[0][1], v[0][2], v[1][0], v[1][1], v[1][2], v[2][0], v[2][1], v[2][2]});
+        }
+        std::sort(tris.begin(), tris.end());
+        return tris;
+    };
+    return key(l) == key(r);
+}
+
+int main()
+{
+    std::vector<BenchMesh> meshes;
+    meshes.push_back(makeGrid("grid", 256, false));
+    meshes.push_back(makeGrid("shuffled", 256, true));
+    meshes.push_back(makeSphere("sphere", 128, 256));
+
+    std::cout << std::left << std::setw(10) << "mesh" << std::right
+              << std::setw(9) << "tris" << std::setw(12) << "acmr16 in" << std::setw(12) << "acmr16 out"
+              << std::setw(12) << "acmr32 out" << std::setw(12) << "atvr16 out" << std::setw(10) << "opt ms"
+              << std::setw(10) << "Mtri/s" << std::endl;
+    std::cout << std::fixed;
+    for (auto &mesh : meshes)
+    {
+        BenchMesh optimized = mesh;
+        double before = VertexCache::acmr(mesh.indices, mesh.vertices.size());
+        auto start = std::chrono::steady_clock::now();
+        VertexCache::optimizeMesh(optimized.vertices, optimized.indices);
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!sameTriangles(mesh, optimized))
+            std::cerr << mesh.name << ": triangle set changed" << std::endl;
+        size_t tris = mesh.indices.size() / 3;
+        std::cout << std::left << std::setw(10) << mesh.name << std::right << std::setw(9) << tris
+                  << std::setprecision(3) << std::setw(12) << before
+                  << std::setw(12) << VertexCache::acmr(optimized.indices, optimized.vertices.size())
+                  << std::setw(12) << VertexCache::acmr(optimized.indices, optimized.vertices.size(), 32)
+                  << std::setw(12) << VertexCache::atvr(optimized.indices, optimized.vertices.size())
+                  << std::setprecision(1) << std::setw(10) << sec * 1e3
+                  << std::setw(10) << tris / sec / 1e6 << std::endl;
+    }
+    return 0;
+}
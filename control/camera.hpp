@@ -177,6 +177,11 @@ public:
         fovy_ -= yoffset * zoomSensitivity_;
         fovy_ = glm::clamp(fovy_, 10.0f, 120.0f);
     }
+    const glm::vec3 &getPosition() const { return position_; }
+    void setPosition(const glm::vec3 &position) { position_ = position; }
+    const glm::vec3 &getFront() const { return front_; }
+    const glm::vec3 &getUp() const { return up_; }
+    const glm::vec3 &getRight() const { return right_; }
     glm::mat4 getGlobalMat() const
     {
         return glm::mat4(
@@ -1,14 +1,11 @@
 #include <string>
-#include <sstream>
-#include <random>
-#include <ctime>
-#include <iomanip>
 #include <mutex>
 #include <shared_mutex>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "camera.hpp"
 #include "movement.hpp"
+#include "uuid.hpp"
 
 #ifndef PLAYER_HPP
 #define PLAYER_HPP
@@ -20,38 +17,17 @@
 class Player : public Camera // 必须在主线程
 {
     // mutable std::shared_mutex smtx_;
-    std::string uuid_v4_;
+    Uuid uuid_v4_;
     bool isFocus_ = true;
 
 private:
     Player(float x, float y, float height)
-        : Camera(x, y, height), uuid_v4_(genUUIDv4()) {}
+        : Camera(x, y, height), uuid_v4_(Uuid::genV4()) {}
     ~Player() = default;
     Player(const Player &) = delete;
     Player &operator=(const Player &) = delete;
     Player(Player &&) = delete;
     Player &operator=(Player &&) = delete;
-    std::string genUUIDv4()
-    {
-        std::random_device rd;
-        static thread_local std::mt19937 gen;
-        if (rd.entropy() == 0.0)
-            gen = std::mt19937(static_cast<unsigned>(std::time(nullptr)));
-        else
-            gen = std::mt19937(rd());
-        std::uniform_int_distribution<uint32_t> dist32(0, 0xFFFFFFFF);
-        std::uniform_int_distribution<uint16_t> dist16(0, 0xFFFF);
-        std::stringstream ss;
-        ss << std::hex << std::setfill('0');
-        ss << std::setw(8) << dist32(gen) << "-";
-        ss << std::setw(4) << dist16(gen) << "-";
-        ss << std::setw(4) << ((dist16(gen) & 0x0FFF) | 0x4000) << "-"; // version 4
-        ss << std::setw(4) << ((dist16(gen) & 0x3FFF) | 0x8000) << "-"; // variant 1 (10xx)
-        ss << std::setw(4) << dist16(gen);
-        ss << std::setw(4) << dist16(gen);
-        ss << std::setw(4) << dist16(gen);
-        return ss.str();
-    }
 
 public:
     static Player &getInstance()
@@ -59,7 +35,7 @@ public:
         static Player instance(VIEW_POS_X, VIEW_POS_Y, VIEW_POS_HEIGHT);
         return instance;
     }
-    std::string getUUIDv4() const { return uuid_v4_; }
+    const Uuid &getUUIDv4() const { return uuid_v4_; }
     bool &getFocus() { return isFocus_; }
     void initCurrentWindowInput(GLFWwindow *window)
     {
@@ -106,12 +82,31 @@ public:
         if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
             Player::getInstance().processPosMove(Movement::DOWN, deltaTime);
     }
+    // 联网时不直接移动相机，只采样按键，第i位对应static_cast<int>(Movement)为i的方向
+    uint8_t pollMoves(GLFWwindow *window) const
+    {
+        uint8_t moves = 0;
+        auto poll = [&](int key, Movement direction)
+        {
+            if (glfwGetKey(window, key) == GLFW_PRESS)
+                moves |= static_cast<uint8_t>(1u << static_cast<int>(direction));
+        };
+        poll(GLFW_KEY_W, Movement::FORWARD);
+        poll(GLFW_KEY_S, Movement::BACKWARD);
+        poll(GLFW_KEY_A, Movement::LEFT);
+        poll(GLFW_KEY_D, Movement::RIGHT);
+        poll(GLFW_KEY_SPACE, Movement::UP);
+        poll(GLFW_KEY_LEFT_CONTROL, Movement::DOWN);
+        return moves;
+    }
 };
 
 struct NetPlayer
 {
-    std::string uuid = "00000000-0000-0000-0000-000000000000";
+    Uuid uuid;
     glm::mat4 globalMat = glm::mat4(1.0f);
+    int32_t id = -1;     // 服务端分配的会话id
+    bool isLeft = false; // 该玩家已离开
 };
 
 #endif
\ No newline at end of file
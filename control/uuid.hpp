@@ -0,0 +1,127 @@
+#include <string>
+#include <string_view>
+#include <random>
+#include <ctime>
+#include <functional>
+#include <string.h>
+#include <stdint.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef UUID_HPP
+#define UUID_HPP
+
+// 文本形式长度（不含'\0'）
+#define UUID_STRING_SIZE 36
+// 二进制形式长度（Byte）
+#define UUID_BYTE_SIZE 16
+
+// 128位UUID值类型，hi/lo按文本顺序各存前后8字节（大端语义）
+// 内部一律以二进制比较、哈希，只在日志与界面等边界处格式化为文本
+struct alignas(16) Uuid
+{
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+
+    static Uuid genV4()
+    {
+        static thread_local std::mt19937_64 gen = []
+        {
+            std::random_device rd;
+            if (rd.entropy() == 0.0)
+                return std::mt19937_64(static_cast<uint64_t>(std::time(nullptr)));
+            return std::mt19937_64((static_cast<uint64_t>(rd()) << 32) | rd());
+        }();
+        Uuid id;
+        id.hi = (gen() & 0xFFFFFFFFFFFF0FFFULL) | 0x0000000000004000ULL; // version 4
+        id.lo = (gen() & 0x3FFFFFFFFFFFFFFFULL) | 0x8000000000000000ULL; // variant 1 (10xx)
+        return id;
+    }
+    bool isNil() const { return 0 == (hi | lo); }
+    bool operator==(const Uuid &other) const
+    {
+#if defined(__SSE2__)
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i *>(this));
+        __m128i b = _mm_load_si128(reinterpret_cast<const __m128i *>(&other));
+        return 0xFFFF == _mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+#else
+        return hi == other.hi && lo == other.lo;
+#endif
+    }
+    bool operator!=(const Uuid &other) const { return !(*this == other); }
+    // 写入UUID_STRING_SIZE个字符，不写'\0'
+    void toChars(char *out) const
+    {
+        static const char digits[] = "0123456789abcdef";
+        int pos = 0;
+        for (int i = 0; i < UUID_BYTE_SIZE; ++i)
+        {
+            if (4 == i || 6 == i || 8 == i || 10 == i)
+                out[pos++] = '-';
+            uint8_t byte = static_cast<uint8_t>((i < 8 ? hi : lo) >> (56 - 8 * (i & 7)));
+            out[pos++] = digits[byte >> 4];
+            out[pos++] = digits[byte & 0xF];
+        }
+    }
+    std::string toString() const
+    {
+        std::string str(UUID_STRING_SIZE, '\0');
+        toChars(str.data());
+        return str;
+    }
+    // rt:
+    //   0   sucess
+    //   -1  malformed
+    static int fromString(std::string_view str, Uuid &id)
+    {
+        if (str.size() != UUID_STRING_SIZE)
+            return -1;
+        uint64_t half[2] = {0, 0};
+        int nibble = 0;
+        for (size_t i = 0; i < str.size(); ++i)
+        {
+            char c = str[i];
+            if (8 == i || 13 == i || 18 == i || 23 == i)
+            {
+                if ('-' != c)
+                    return -1;
+                continue;
+            }
+            int v;
+            if (c >= '0' && c <= '9')
+                v = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                v = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                v = c - 'A' + 10;
+            else
+                return -1;
+            half[nibble >> 4] = (half[nibble >> 4] << 4) | v;
+            ++nibble;
+        }
+        id.hi = half[0];
+        id.lo = half[1];
+        return 0;
+    }
+};
+
+// v4的随机位已足够均匀，仍做一次混合以兼容手工构造的顺序id
+struct UuidHash
+{
+    size_t operator()(const Uuid &id) const noexcept
+    {
+        uint64_t h = id.hi ^ (id.lo * 0x9E3779B97F4A7C15ULL);
+        h ^= h >> 32;
+        h *= 0xD6E8FEB86659FD93ULL;
+        h ^= h >> 32;
+        return static_cast<size_t>(h);
+    }
+};
+
+template <>
+struct std::hash<Uuid> : UuidHash
+{
+};
+
+#endif
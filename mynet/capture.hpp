@@ -0,0 +1,141 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+// 文件头：6字节魔数 + 2字节版本
+#define CAPTURE_MAGIC "BBGCAP"
+#define CAPTURE_VERSION 1
+#define CAPTURE_FILE_HEADER_SIZE 8
+// 记录头长度（Byte）：timeNs + conn + kind + len
+#define CAPTURE_RECORD_HEADER_SIZE (8 + 4 + 1 + 4)
+// 线程缓冲超过此大小时写入文件（Byte）
+#define CAPTURE_FLUSH_SIZE (64 * 1024)
+
+// 抓包记录，时间为相对开始抓包的纳秒数，conn在一次抓包内唯一
+struct CaptureRecord
+{
+    enum Kind : uint8_t
+    {
+        OPEN,  // 连接建立
+        FRAME, // 收到的一帧（不含4字节长度，含结尾'\0'），心跳同样记录
+        CLOSE  // 连接关闭
+    };
+    uint64_t timeNs = 0;
+    uint32_t conn = 0;
+    Kind kind = FRAME;
+    std::string data;
+};
+
+// 只追加的二进制抓包日志，小端紧凑排列：
+//   文件头 | 记录头(timeNs u64, conn u32, kind u8, len u32) + data | ...
+// 各线程先写入自己的缓冲，再整块加锁写入，因此不同线程的记录在文件中只按块有序
+class CaptureWriter
+{
+    using Clock = std::chrono::steady_clock;
+
+    FILE *file_;
+    std::mutex mtx_;
+    Clock::time_point start_;
+
+public:
+    explicit CaptureWriter(const std::string &path)
+        : file_(fopen(path.c_str(), "wb")),
+          start_(Clock::now())
+    {
+        if (nullptr == file_)
+            throw std::runtime_error("fopen capture file failed");
+        char header[CAPTURE_FILE_HEADER_SIZE];
+        uint16_t version = CAPTURE_VERSION;
+        memcpy(header, CAPTURE_MAGIC, 6);
+        memcpy(header + 6, &version, 2);
+        fwrite(header, 1, sizeof(header), file_);
+    }
+    ~CaptureWriter() { fclose(file_); }
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter &operator=(const CaptureWriter &) = delete;
+    CaptureWriter(CaptureWriter &&) = delete;
+    CaptureWriter &operator=(CaptureWriter &&) = delete;
+    // 以当前时间追加一条记录到调用线程的缓冲buf
+    void append(std::string &buf, uint32_t conn, CaptureRecord::Kind kind, std::string_view data = {}) const
+    {
+        uint64_t timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count();
+        uint8_t k = kind;
+        uint32_t len = static_cast<uint32_t>(data.size());
+        size_t old = buf.size();
+        buf.resize(old + CAPTURE_RECORD_HEADER_SIZE);
+        char *p = buf.data() + old;
+        memcpy(p, &timeNs, 8);
+        memcpy(p + 8, &conn, 4);
+        memcpy(p + 12, &k, 1);
+        memcpy(p + 13, &len, 4);
+        buf.append(data);
+    }
+    // 缓冲达到CAPTURE_FLUSH_SIZE或force时写入文件并清空
+    void flush_r(std::string &buf, bool force = false)
+    {
+        if (buf.empty() || (!force && buf.size() < CAPTURE_FLUSH_SIZE))
+            return;
+        std::lock_guard<std::mutex> lock(mtx_);
+        fwrite(buf.data(), 1, buf.size(), file_);
+        fflush(file_);
+        buf.clear();
+    }
+};
+
+class CaptureReader
+{
+public:
+    // 读取全部记录并按时间稳定排序，末尾不完整的记录（抓包进程异常退出）被忽略
+    // rt:
+    //   0   sucess
+    //   -1  open failed
+    //   -2  not a capture file
+    static int load(const std::string &path, std::vector<CaptureRecord> &records)
+    {
+        records.clear();
+        FILE *file = fopen(path.c_str(), "rb");
+        if (nullptr == file)
+            return -1;
+        char header[CAPTURE_FILE_HEADER_SIZE];
+        uint16_t version = 0;
+        if (sizeof(header) != fread(header, 1, sizeof(header), file) ||
+            0 != memcmp(header, CAPTURE_MAGIC, 6) ||
+            (memcpy(&version, header + 6, 2), CAPTURE_VERSION != version))
+        {
+            fclose(file);
+            return -2;
+        }
+        char rh[CAPTURE_RECORD_HEADER_SIZE];
+        while (sizeof(rh) == fread(rh, 1, sizeof(rh), file))
+        {
+            CaptureRecord record;
+            uint8_t kind = 0;
+            uint32_t len = 0;
+            memcpy(&record.timeNs, rh, 8);
+            memcpy(&record.conn, rh + 8, 4);
+            memcpy(&kind, rh + 12, 1);
+            memcpy(&len, rh + 13, 4);
+            record.kind = static_cast<CaptureRecord::Kind>(kind);
+            record.data.resize(len);
+            if (len != fread(record.data.data(), 1, len, file))
+                break;
+            records.push_back(std::move(record));
+        }
+        fclose(file);
+        std::stable_sort(records.begin(), records.end(), [](const CaptureRecord &a, const CaptureRecord &b)
+                         { return a.timeNs < b.timeNs; });
+        return 0;
+    }
+};
+
+#endif
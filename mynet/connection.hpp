@@ -0,0 +1,216 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <memory>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include "crypt.hpp"
+
+#ifndef CONNECTION_HPP
+#define CONNECTION_HPP
+
+// 单连接输出缓冲上限，超过则视为慢客户端（Byte）
+#define MAX_OUTPUT_BUFFER_SIZE (256 * 1024)
+// 输出缓冲低于此值时才写入被合并的状态帧（Byte）
+#define OUTPUT_LOW_WATERMARK (16 * 1024)
+// 单帧最大长度，超过则视为非法数据（Byte）
+#define MAX_FRAME_SIZE (64 * 1024)
+// 单次recv读取块大小（Byte）
+#define RECV_CHUNK_SIZE (16 * 1024)
+// 单连接等待分发（被延后）的最大帧数
+#define MAX_WAITING_FRAME_NUM 256
+
+// 非阻塞连接的输入输出缓冲，帧格式与Peer_ser一致（4字节长度 + 数据 + '\0'）
+// 启用加密后为（4字节长度 + 密文(数据 + '\0') + 标签），在缓冲中原地加解密
+// 只能在所属SubReactor线程中使用！
+class Connection
+{
+    int fd_;
+    uint64_t serial_; // 所属SubReactor内唯一，用于识别fd被复用后过期的异步结果
+    bool inFlight_;   // 是否有帧正在工作线程中处理
+    uint8_t caps_;    // MSG_HELLO协商出的能力位，决定发往该连接的消息能否压缩
+    std::string inBuf_;
+    std::string outBuf_;
+    size_t outPos_; // outBuf_中已发送的前缀长度
+    // 每个key只保留最新一帧被合并的状态帧（已编码），落后时旧的直接丢弃
+    std::vector<std::pair<uint64_t, std::string>> pendingStates_;
+    size_t pendingStateBytes_;
+    std::deque<std::string> waiting_; // 等待分发的帧，队首被Handler延后时后续帧排在其后以保序
+    std::unique_ptr<CryptSession> crypt_; // 为空则不加密
+
+public:
+    explicit Connection(int fd, uint64_t serial = 0)
+        : fd_(fd), serial_(serial), inFlight_(false), caps_(0), outPos_(0), pendingStateBytes_(0) {}
+    ~Connection() = default;
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+    Connection(Connection &&) = default;
+    Connection &operator=(Connection &&) = default;
+    int getFd() const { return fd_; }
+    uint64_t getSerial() const { return serial_; }
+    bool &getInFlight() { return inFlight_; }
+    uint8_t &getCaps() { return caps_; }
+    size_t pendingBytes() const { return outBuf_.size() - outPos_ + pendingStateBytes_; }
+    std::deque<std::string> &getWaiting() { return waiting_; }
+    bool isEncrypted() const { return nullptr != crypt_; }
+    // 此后收发的帧均加解密，已进入输出缓冲的帧不受影响
+    void setCrypt(std::unique_ptr<CryptSession> crypt) { crypt_ = std::move(crypt); }
+    // 边缘触发，读到EAGAIN为止，每个完整帧调用一次onFrame(std::string)，回调中不可销毁本连接
+    // rt:
+    //   0   sucess
+    //   -1  peer closed or error
+    //   -2  frame too large or too short
+    //   -3  authentication failed
+    template <class F>
+    int readFrames(F &&onFrame)
+    {
+        for (;;)
+        {
+            size_t old = inBuf_.size();
+            inBuf_.resize(old + RECV_CHUNK_SIZE);
+            ssize_t n = ::recv(fd_, inBuf_.data() + old, RECV_CHUNK_SIZE, 0);
+            inBuf_.resize(old + (n > 0 ? n : 0));
+            if (0 == n)
+                return -1;
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return 0;
+                return -1;
+            }
+            size_t pos = 0;
+            while (inBuf_.size() - pos >= 4)
+            {
+                uint32_t len = 0;
+                memcpy(&len, inBuf_.data() + pos, 4);
+                if (len > MAX_FRAME_SIZE)
+                    return -2;
+                if (inBuf_.size() - pos - 4 < len)
+                    break;
+                if (crypt_) // 每帧都重新判断，onFrame中可能刚启用加密
+                {
+                    if (len <= CRYPT_TAG_SIZE)
+                        return -2;
+                    len -= CRYPT_TAG_SIZE;
+                    uint8_t *body = reinterpret_cast<uint8_t *>(inBuf_.data() + pos + 4);
+                    if (0 != crypt_->open(body, len, body + len))
+                        return -3;
+                    onFrame(std::string(inBuf_.data() + pos + 4, len));
+                    pos += 4 + len + CRYPT_TAG_SIZE;
+                    continue;
+                }
+                onFrame(std::string(inBuf_.data() + pos + 4, len));
+                pos += 4 + len;
+            }
+            inBuf_.erase(0, pos);
+        }
+    }
+    // 可靠帧，必须送达
+    // rt:
+    //   0   sucess
+    //   -1  output buffer quota exceeded
+    int queueFrame(std::string_view data)
+    {
+        if (pendingBytes() + data.size() + 5 + (crypt_ ? CRYPT_TAG_SIZE : 0) > MAX_OUTPUT_BUFFER_SIZE) // 长度 + 帧尾 + 加密标签
+            return -1;
+        compact();
+        size_t start = outBuf_.size();
+        appendFrame(outBuf_, data);
+        sealFrame(start);
+        return 0;
+    }
+    // 可合并的状态帧（心跳、状态同步等），客户端落后时同一key只保留最新一帧
+    // 在flush时才加密，计入pendingBytes时总是按带加密标签计，避免期间启用加密后加减不一致
+    void queueState(uint64_t key, std::string_view data)
+    {
+        for (auto &state : pendingStates_)
+            if (state.first == key)
+            {
+                pendingStateBytes_ -= state.second.size() + CRYPT_TAG_SIZE;
+                state.second.clear();
+                appendFrame(state.second, data);
+                pendingStateBytes_ += state.second.size() + CRYPT_TAG_SIZE;
+                return;
+            }
+        pendingStates_.emplace_back(key, std::string());
+        appendFrame(pendingStates_.back().second, data);
+        pendingStateBytes_ += pendingStates_.back().second.size() + CRYPT_TAG_SIZE;
+    }
+    // rt:
+    //   0   all sent
+    //   1   data remains, wait for EPOLLOUT
+    //   -1  error
+    int flush()
+    {
+        for (;;)
+        {
+            if (!pendingStates_.empty() && outBuf_.size() - outPos_ < OUTPUT_LOW_WATERMARK)
+            {
+                compact();
+                for (auto &state : pendingStates_)
+                {
+                    size_t start = outBuf_.size();
+                    outBuf_.append(state.second);
+                    sealFrame(start); // 加密须按实际发送顺序
+                }
+                pendingStates_.clear();
+                pendingStateBytes_ = 0;
+            }
+            if (outPos_ == outBuf_.size())
+            {
+                outBuf_.clear();
+                outPos_ = 0;
+                return 0;
+            }
+            ssize_t n = ::send(fd_, outBuf_.data() + outPos_, outBuf_.size() - outPos_, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return 1;
+                return -1;
+            }
+            outPos_ += static_cast<size_t>(n);
+        }
+    }
+
+private:
+    void compact()
+    {
+        if (outPos_ > 0 && outPos_ * 2 >= outBuf_.size())
+        {
+            outBuf_.erase(0, outPos_);
+            outPos_ = 0;
+        }
+    }
+    // 原地加密outBuf_中从start开始的一帧，并追加标签、修正长度
+    void sealFrame(size_t start)
+    {
+        if (!crypt_)
+            return;
+        uint32_t len = 0;
+        memcpy(&len, outBuf_.data() + start, 4);
+        outBuf_.resize(outBuf_.size() + CRYPT_TAG_SIZE);
+        uint8_t *body = reinterpret_cast<uint8_t *>(outBuf_.data() + start + 4);
+        crypt_->seal(body, len, body + len);
+        len += CRYPT_TAG_SIZE;
+        memcpy(outBuf_.data() + start, &len, 4);
+    }
+    static void appendFrame(std::string &buf, std::string_view data)
+    {
+        uint32_t len = data.size() + 1;
+        buf.append(reinterpret_cast<const char *>(&len), 4);
+        buf.append(data);
+        buf.push_back('\0');
+    }
+};
+
+#endif
@@ -1,4 +1,729 @@
+#include <array>
+#include <string_view>
+#include <stdexcept>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/random.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
 #ifndef CRYPT_HPP
 #define CRYPT_HPP
 
-#endif
\ No newline at end of file
+// 密钥长度（Byte）
+#define CRYPT_KEY_SIZE 32
+// 握手时双方各自生成的随机数长度（Byte）
+#define CRYPT_RANDOM_SIZE 16
+// 认证标签长度（Byte）
+#define CRYPT_TAG_SIZE 16
+
+// AEAD每次加密/认证的分块大小（Byte，64的倍数），同一块加密后立即认证，数据仍在L1中
+#define CRYPT_CHUNK_SIZE 2048
+// Poly1305至少多少字节时走AVX2的4路并行，较短时换算累加器的开销不划算
+#define POLY1305_AVX2_MIN_SIZE 256
+// 运行时检测到AVX2时使用8块并行的ChaCha20与4路并行的Poly1305，编译时无需-mavx2
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CRYPT_AVX2 1
+#else
+#define CRYPT_AVX2 0
+#endif
+
+using CryptKey = std::array<uint8_t, CRYPT_KEY_SIZE>;
+
+#if CRYPT_AVX2
+inline bool cryptHasAvx2()
+{
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+
+// RFC 8439 ChaCha20，x86上以AVX2每次并行生成8个块，不支持时以SSE2并行生成4个块
+class ChaCha20
+{
+public:
+    // 从counter对应的块开始生成密钥流并异或到data，原地加解密
+    static void xorStream(const uint8_t key[CRYPT_KEY_SIZE], const uint8_t nonce[12], uint32_t counter, uint8_t *data, size_t n)
+    {
+        uint32_t state[16];
+        init(state, key, nonce, counter);
+#if CRYPT_AVX2
+        if (n >= 512 && cryptHasAvx2())
+        {
+            for (; n >= 512; n -= 512, data += 512)
+            {
+                blocks8(state, data);
+                state[12] += 8;
+            }
+        }
+#endif
+#if defined(__SSE2__)
+        for (; n >= 256; n -= 256, data += 256)
+        {
+            blocks4(state, data);
+            state[12] += 4;
+        }
+#endif
+        uint8_t stream[64];
+        for (; n > 0; ++state[12])
+        {
+            block(state, stream);
+            size_t take = n < 64 ? n : 64;
+            for (size_t i = 0; i < take; ++i)
+                data[i] ^= stream[i];
+            data += take;
+            n -= take;
+        }
+    }
+    // 同xorStream，只走标量路径，供基准对比
+    static void xorStreamScalar(const uint8_t key[CRYPT_KEY_SIZE], const uint8_t nonce[12], uint32_t counter, uint8_t *data, size_t n)
+    {
+        uint32_t state[16];
+        init(state, key, nonce, counter);
+        uint8_t stream[64];
+        for (; n > 0; ++state[12])
+        {
+            block(state, stream);
+            size_t take = n < 64 ? n : 64;
+            for (size_t i = 0; i < take; ++i)
+                data[i] ^= stream[i];
+            data += take;
+            n -= take;
+        }
+    }
+    // 单个密钥流块
+    static void block(const uint8_t key[CRYPT_KEY_SIZE], const uint8_t nonce[12], uint32_t counter, uint8_t out[64])
+    {
+        uint32_t state[16];
+        init(state, key, nonce, counter);
+        block(state, out);
+    }
+    // HChaCha20：由密钥与16字节输入派生子密钥
+    static void hchacha(const uint8_t key[CRYPT_KEY_SIZE], const uint8_t in[16], uint8_t out[CRYPT_KEY_SIZE])
+    {
+        uint32_t x[16];
+        x[0] = 0x61707865;
+        x[1] = 0x3320646e;
+        x[2] = 0x79622d32;
+        x[3] = 0x6b206574;
+        for (int i = 0; i < 8; ++i)
+            x[4 + i] = load32(key + 4 * i);
+        for (int i = 0; i < 4; ++i)
+            x[12 + i] = load32(in + 4 * i);
+        rounds(x);
+        for (int i = 0; i < 4; ++i)
+        {
+            store32(out + 4 * i, x[i]);
+            store32(out + 16 + 4 * i, x[12 + i]);
+        }
+    }
+
+private:
+    static uint32_t load32(const uint8_t *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, 4); // 小端平台
+        return v;
+    }
+    static void store32(uint8_t *p, uint32_t v) { memcpy(p, &v, 4); }
+    static uint32_t rotl(uint32_t v, int c) { return (v << c) | (v >> (32 - c)); }
+    static void quarter(uint32_t &a, uint32_t &b, uint32_t &c, uint32_t &d)
+    {
+        a += b, d ^= a, d = rotl(d, 16);
+        c += d, b ^= c, b = rotl(b, 12);
+        a += b, d ^= a, d = rotl(d, 8);
+        c += d, b ^= c, b = rotl(b, 7);
+    }
+    static void rounds(uint32_t x[16])
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            quarter(x[0], x[4], x[8], x[12]);
+            quarter(x[1], x[5], x[9], x[13]);
+            quarter(x[2], x[6], x[10], x[14]);
+            quarter(x[3], x[7], x[11], x[15]);
+            quarter(x[0], x[5], x[10], x[15]);
+            quarter(x[1], x[6], x[11], x[12]);
+            quarter(x[2], x[7], x[8], x[13]);
+            quarter(x[3], x[4], x[9], x[14]);
+        }
+    }
+    static void init(uint32_t state[16], const uint8_t key[CRYPT_KEY_SIZE], const uint8_t nonce[12], uint32_t counter)
+    {
+        state[0] = 0x61707865;
+        state[1] = 0x3320646e;
+        state[2] = 0x79622d32;
+        state[3] = 0x6b206574;
+        for (int i = 0; i < 8; ++i)
+            state[4 + i] = load32(key + 4 * i);
+        state[12] = counter;
+        for (int i = 0; i < 3; ++i)
+            state[13 + i] = load32(nonce + 4 * i);
+    }
+    static void block(const uint32_t state[16], uint8_t out[64])
+    {
+        uint32_t x[16];
+        memcpy(x, state, sizeof(x));
+        rounds(x);
+        for (int i = 0; i < 16; ++i)
+            store32(out + 4 * i, x[i] + state[i]);
+    }
+#if defined(__SSE2__)
+    static __m128i rotlv(__m128i v, int c) { return _mm_or_si128(_mm_slli_epi32(v, c), _mm_srli_epi32(v, 32 - c)); }
+    static void quarterv(__m128i &a, __m128i &b, __m128i &c, __m128i &d)
+    {
+        a = _mm_add_epi32(a, b), d = rotlv(_mm_xor_si128(d, a), 16);
+        c = _mm_add_epi32(c, d), b = rotlv(_mm_xor_si128(b, c), 12);
+        a = _mm_add_epi32(a, b), d = rotlv(_mm_xor_si128(d, a), 8);
+        c = _mm_add_epi32(c, d), b = rotlv(_mm_xor_si128(b, c), 7);
+    }
+    // 每个寄存器存放4个连续块的同一个状态字，计算后转置回按块排列再异或到data[0, 256)
+    static void blocks4(const uint32_t state[16], uint8_t *data)
+    {
+        __m128i in[16];
+        __m128i x[16];
+        for (int i = 0; i < 16; ++i)
+            in[i] = _mm_set1_epi32(static_cast<int>(state[i]));
+        in[12] = _mm_add_epi32(in[12], _mm_set_epi32(3, 2, 1, 0));
+        for (int i = 0; i < 16; ++i)
+            x[i] = in[i];
+        for (int i = 0; i < 10; ++i)
+        {
+            quarterv(x[0], x[4], x[8], x[12]);
+            quarterv(x[1], x[5], x[9], x[13]);
+            quarterv(x[2], x[6], x[10], x[14]);
+            quarterv(x[3], x[7], x[11], x[15]);
+            quarterv(x[0], x[5], x[10], x[15]);
+            quarterv(x[1], x[6], x[11], x[12]);
+            quarterv(x[2], x[7], x[8], x[13]);
+            quarterv(x[3], x[4], x[9], x[14]);
+        }
+        for (int i = 0; i < 16; ++i)
+            x[i] = _mm_add_epi32(x[i], in[i]);
+        for (int g = 0; g < 4; ++g)
+        {
+            __m128i t0 = _mm_unpacklo_epi32(x[4 * g], x[4 * g + 1]);
+            __m128i t1 = _mm_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m128i t2 = _mm_unpackhi_epi32(x[4 * g], x[4 * g + 1]);
+            __m128i t3 = _mm_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m128i b[4] = {_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+                            _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3)};
+            for (int k = 0; k < 4; ++k)
+            {
+                __m128i *p = reinterpret_cast<__m128i *>(data + 64 * k + 16 * g);
+                _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), b[k]));
+            }
+        }
+    }
+#endif
+#if CRYPT_AVX2
+    // 循环移位16与8位用字节重排
+    __attribute__((target("avx2"))) static void quarter8(__m256i &a, __m256i &b, __m256i &c, __m256i &d)
+    {
+        const __m256i rot16 = _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+                                              13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2);
+        const __m256i rot8 = _mm256_set_epi8(14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3,
+                                             14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3);
+        a = _mm256_add_epi32(a, b), d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16);
+        c = _mm256_add_epi32(c, d), b = _mm256_xor_si256(b, c);
+        b = _mm256_or_si256(_mm256_slli_epi32(b, 12), _mm256_srli_epi32(b, 20));
+        a = _mm256_add_epi32(a, b), d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8);
+        c = _mm256_add_epi32(c, d), b = _mm256_xor_si256(b, c);
+        b = _mm256_or_si256(_mm256_slli_epi32(b, 7), _mm256_srli_epi32(b, 25));
+    }
+    // 同blocks4，8个连续块，异或到data[0, 512)
+    __attribute__((target("avx2"))) static void blocks8(const uint32_t state[16], uint8_t *data)
+    {
+        // 初始状态在末尾重新广播，不另存一份，减少寄存器溢出
+        const __m256i counter = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+        __m256i x[16];
+        for (int i = 0; i < 16; ++i)
+            x[i] = _mm256_set1_epi32(static_cast<int>(state[i]));
+        x[12] = _mm256_add_epi32(x[12], counter);
+#pragma GCC unroll 10
+        for (int i = 0; i < 10; ++i)
+        {
+            quarter8(x[0], x[4], x[8], x[12]);
+            quarter8(x[1], x[5], x[9], x[13]);
+            quarter8(x[2], x[6], x[10], x[14]);
+            quarter8(x[3], x[7], x[11], x[15]);
+            quarter8(x[0], x[5], x[10], x[15]);
+            quarter8(x[1], x[6], x[11], x[12]);
+            quarter8(x[2], x[7], x[8], x[13]);
+            quarter8(x[3], x[4], x[9], x[14]);
+        }
+        for (int i = 0; i < 16; ++i)
+            x[i] = _mm256_add_epi32(x[i], _mm256_set1_epi32(static_cast<int>(state[i])));
+        x[12] = _mm256_add_epi32(x[12], counter);
+        // 每组4个状态字转置后，低128位属于块k，高128位属于块k + 4
+        __m256i b[4][4];
+        for (int g = 0; g < 4; ++g)
+        {
+            __m256i t0 = _mm256_unpacklo_epi32(x[4 * g], x[4 * g + 1]);
+            __m256i t1 = _mm256_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m256i t2 = _mm256_unpackhi_epi32(x[4 * g], x[4 * g + 1]);
+            __m256i t3 = _mm256_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+            b[g][0] = _mm256_unpacklo_epi64(t0, t1);
+            b[g][1] = _mm256_unpackhi_epi64(t0, t1);
+            b[g][2] = _mm256_unpacklo_epi64(t2, t3);
+            b[g][3] = _mm256_unpackhi_epi64(t2, t3);
+        }
+        for (int k = 0; k < 4; ++k)
+            for (int g = 0; g < 4; g += 2)
+            {
+                __m256i lo = _mm256_permute2x128_si256(b[g][k], b[g + 1][k], 0x20);
+                __m256i hi = _mm256_permute2x128_si256(b[g][k], b[g + 1][k], 0x31);
+                __m256i *p = reinterpret_cast<__m256i *>(data + 64 * k + 16 * g);
+                __m256i *q = reinterpret_cast<__m256i *>(data + 64 * (k + 4) + 16 * g);
+                _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), lo));
+                _mm256_storeu_si256(q, _mm256_xor_si256(_mm256_loadu_si256(q), hi));
+            }
+    }
+#endif
+};
+
+// RFC 8439 Poly1305，44/44/42位三段表示，依赖unsigned __int128
+// 支持AVX2时较长的输入按26位五段表示4路并行：第i路累加第4k + i个块，每轮乘r^4，最后各路分别乘r^4、r^3、r^2、r再求和
+class Poly1305
+{
+    uint64_t r_[3];
+    uint64_t h_[3];
+    uint64_t pad_[2];
+    uint8_t buf_[16];
+    size_t bufLen_;
+#if CRYPT_AVX2
+    uint32_t rpow_[4][5]; // r^(i + 1)的26位五段表示，首次走AVX2时计算
+    bool rpowReady_;
+#endif
+
+public:
+    explicit Poly1305(const uint8_t key[32])
+        : h_{0, 0, 0}, bufLen_(0)
+#if CRYPT_AVX2
+          ,
+          rpowReady_(false)
+#endif
+    {
+        uint64_t t0 = load64(key);
+        uint64_t t1 = load64(key + 8);
+        r_[0] = t0 & 0xffc0fffffff;
+        r_[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffff;
+        r_[2] = (t1 >> 24) & 0x00ffffffc0f;
+        pad_[0] = load64(key + 16);
+        pad_[1] = load64(key + 24);
+    }
+    void update(const uint8_t *p, size_t n)
+    {
+        if (bufLen_ > 0)
+        {
+            size_t take = 16 - bufLen_ < n ? 16 - bufLen_ : n;
+            memcpy(buf_ + bufLen_, p, take);
+            bufLen_ += take;
+            p += take;
+            n -= take;
+            if (bufLen_ < 16)
+                return;
+            blocks(buf_, 16, 1ULL << 40);
+            bufLen_ = 0;
+        }
+        size_t full = n & ~static_cast<size_t>(15);
+        blocks(p, full, 1ULL << 40);
+        memcpy(buf_, p + full, n - full);
+        bufLen_ = n - full;
+    }
+    // 补零到16字节边界（AEAD的填充）
+    void pad16()
+    {
+        if (0 == bufLen_)
+            return;
+        memset(buf_ + bufLen_, 0, 16 - bufLen_);
+        blocks(buf_, 16, 1ULL << 40);
+        bufLen_ = 0;
+    }
+    void finish(uint8_t tag[CRYPT_TAG_SIZE])
+    {
+        if (bufLen_ > 0)
+        {
+            buf_[bufLen_] = 1;
+            memset(buf_ + bufLen_ + 1, 0, 15 - bufLen_);
+            blocks(buf_, 16, 0);
+        }
+        const uint64_t mask44 = 0xfffffffffff, mask42 = 0x3ffffffffff;
+        uint64_t h0 = h_[0], h1 = h_[1], h2 = h_[2], c;
+        c = h1 >> 44, h1 &= mask44, h2 += c;
+        c = h2 >> 42, h2 &= mask42, h0 += c * 5;
+        c = h0 >> 44, h0 &= mask44, h1 += c;
+        c = h1 >> 44, h1 &= mask44, h2 += c;
+        c = h2 >> 42, h2 &= mask42, h0 += c * 5;
+        c = h0 >> 44, h0 &= mask44, h1 += c;
+        // g = h + 5 - 2^130，不小于0时取g
+        uint64_t g0 = h0 + 5;
+        c = g0 >> 44, g0 &= mask44;
+        uint64_t g1 = h1 + c;
+        c = g1 >> 44, g1 &= mask44;
+        uint64_t g2 = h2 + c - (1ULL << 42);
+        uint64_t sel = (g2 >> 63) - 1; // g2非负时全1
+        h0 = (h0 & ~sel) | (g0 & sel);
+        h1 = (h1 & ~sel) | (g1 & sel);
+        h2 = (h2 & ~sel) | (g2 & sel);
+        // h += pad，转回两个64位
+        uint64_t t0 = pad_[0], t1 = pad_[1];
+        h0 += t0 & mask44;
+        c = h0 >> 44, h0 &= mask44;
+        h1 += (((t0 >> 44) | (t1 << 20)) & mask44) + c;
+        c = h1 >> 44, h1 &= mask44;
+        h2 += ((t1 >> 24) & mask42) + c;
+        h2 &= mask42;
+        store64(tag, h0 | (h1 << 44));
+        store64(tag + 8, (h1 >> 20) | (h2 << 24));
+    }
+
+private:
+    static uint64_t load64(const uint8_t *p)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        return v;
+    }
+    static void store64(uint8_t *p, uint64_t v) { memcpy(p, &v, 8); }
+    void blocks(const uint8_t *p, size_t n, uint64_t hibit)
+    {
+#if CRYPT_AVX2
+        if (n >= POLY1305_AVX2_MIN_SIZE && 0 != hibit && cryptHasAvx2())
+        {
+            size_t full = n & ~static_cast<size_t>(63);
+            blocks4(p, full);
+            p += full;
+            n -= full;
+        }
+#endif
+        const uint64_t mask44 = 0xfffffffffff, mask42 = 0x3ffffffffff;
+        const uint64_t r0 = r_[0], r1 = r_[1], r2 = r_[2];
+        uint64_t h0 = h_[0], h1 = h_[1], h2 = h_[2];
+        for (; n >= 16; n -= 16, p += 16)
+        {
+            uint64_t t0 = load64(p), t1 = load64(p + 8);
+            h0 += t0 & mask44;
+            h1 += ((t0 >> 44) | (t1 << 20)) & mask44;
+            h2 += (((t1 >> 24)) & mask42) | hibit;
+            mul(h0, h1, h2, r0, r1, r2);
+        }
+        h_[0] = h0, h_[1] = h1, h_[2] = h2;
+    }
+    // h = h * r mod 2^130 - 5，只做部分约简
+    static void mul(uint64_t &h0, uint64_t &h1, uint64_t &h2, uint64_t r0, uint64_t r1, uint64_t r2)
+    {
+        using u128 = unsigned __int128;
+        const uint64_t mask44 = 0xfffffffffff, mask42 = 0x3ffffffffff;
+        const uint64_t s1 = r1 * (5 << 2), s2 = r2 * (5 << 2);
+        u128 d0 = (u128)h0 * r0 + (u128)h1 * s2 + (u128)h2 * s1;
+        u128 d1 = (u128)h0 * r1 + (u128)h1 * r0 + (u128)h2 * s2;
+        u128 d2 = (u128)h0 * r2 + (u128)h1 * r1 + (u128)h2 * r0;
+        uint64_t c = static_cast<uint64_t>(d0 >> 44);
+        h0 = static_cast<uint64_t>(d0) & mask44;
+        d1 += c;
+        c = static_cast<uint64_t>(d1 >> 44);
+        h1 = static_cast<uint64_t>(d1) & mask44;
+        d2 += c;
+        c = static_cast<uint64_t>(d2 >> 42);
+        h2 = static_cast<uint64_t>(d2) & mask42;
+        h0 += c * 5;
+        c = h0 >> 44;
+        h0 &= mask44;
+        h1 += c;
+    }
+#if CRYPT_AVX2
+    // 44位三段与26位五段互转，转出前h0、h1须不超过44位
+    static void to26(const uint64_t h[3], uint64_t t[5])
+    {
+        const uint64_t mask26 = 0x3ffffff;
+        t[0] = h[0] & mask26;
+        t[1] = (h[0] >> 26) | ((h[1] << 18) & mask26);
+        t[2] = (h[1] >> 8) & mask26;
+        t[3] = (h[1] >> 34) | ((h[2] << 10) & mask26);
+        t[4] = h[2] >> 16;
+    }
+    // t各段可略超26位，按加法拼接后再进位
+    static void from26(const uint64_t t[5], uint64_t h[3])
+    {
+        h[0] = t[0] + ((t[1] & 0x3ffff) << 26);
+        h[1] = (t[1] >> 18) + (t[2] << 8) + ((t[3] & 0x3ff) << 34);
+        h[2] = (t[3] >> 10) + (t[4] << 16);
+        carry44(h);
+    }
+    static void carry44(uint64_t h[3])
+    {
+        const uint64_t mask44 = 0xfffffffffff;
+        h[1] += h[0] >> 44, h[0] &= mask44;
+        h[2] += h[1] >> 44, h[1] &= mask44;
+    }
+    void powers()
+    {
+        uint64_t h[3] = {r_[0], r_[1], r_[2]}, t[5];
+        for (int i = 0; i < 4; ++i)
+        {
+            if (i > 0)
+            {
+                mul(h[0], h[1], h[2], r_[0], r_[1], r_[2]);
+                carry44(h);
+            }
+            to26(h, t);
+            for (int j = 0; j < 5; ++j)
+                rpow_[i][j] = static_cast<uint32_t>(t[j]);
+        }
+        rpowReady_ = true;
+    }
+    // d = h * r，d各段不超过59位
+    __attribute__((target("avx2"))) static void mul4(const __m256i h[5], const __m256i r[5], const __m256i s[5], __m256i d[5])
+    {
+        d[0] = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h[0], r[0]), _mm256_mul_epu32(h[1], s[4])),
+                                _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h[2], s[3]), _mm256_mul_epu32(h[3], s[2])),
+                                                 _mm256_mul_epu32(h[4], s[1])));
+        d[1] = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h[0], r[1]), _mm256_mul_epu32(h[1], r[0])),
+                                _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h[2], s[4]), _mm256_mul_epu32(h[3], s[3])),
+                                                 _mm256_mul_epu32(h[4], s[2])));
+        d[2] = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h[0], r[2]), _mm256_mul_epu32(h[1], r[1])),
+                                _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h[2], r[0]), _mm256_mul_epu32(h[3], s[4])),
+                                                 _mm256_mul_epu32(h[4], s[3])));
+        d[3] = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h[0], r[3]), _mm256_mul_epu32(h[1], r[2])),
+                                _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h[2], r[1]), _mm256_mul_epu32(h[3], r[0])),
+                                                 _mm256_mul_epu32(h[4], s[4])));
+        d[4] = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h[0], r[4]), _mm256_mul_epu32(h[1], r[3])),
+                                _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h[2], r[2]), _mm256_mul_epu32(h[3], r[1])),
+                                                 _mm256_mul_epu32(h[4], r[0])));
+    }
+    // 部分进位，之后各段不超过27位
+    __attribute__((target("avx2"))) static void carry4(__m256i d[5])
+    {
+        const __m256i mask26 = _mm256_set1_epi64x(0x3ffffff);
+        __m256i c;
+        c = _mm256_srli_epi64(d[0], 26), d[0] = _mm256_and_si256(d[0], mask26), d[1] = _mm256_add_epi64(d[1], c);
+        c = _mm256_srli_epi64(d[3], 26), d[3] = _mm256_and_si256(d[3], mask26), d[4] = _mm256_add_epi64(d[4], c);
+        c = _mm256_srli_epi64(d[1], 26), d[1] = _mm256_and_si256(d[1], mask26), d[2] = _mm256_add_epi64(d[2], c);
+        c = _mm256_srli_epi64(d[4], 26), d[4] = _mm256_and_si256(d[4], mask26);
+        d[0] = _mm256_add_epi64(d[0], _mm256_add_epi64(c, _mm256_slli_epi64(c, 2)));
+        c = _mm256_srli_epi64(d[2], 26), d[2] = _mm256_and_si256(d[2], mask26), d[3] = _mm256_add_epi64(d[3], c);
+        c = _mm256_srli_epi64(d[0], 26), d[0] = _mm256_and_si256(d[0], mask26), d[1] = _mm256_add_epi64(d[1], c);
+        c = _mm256_srli_epi64(d[3], 26), d[3] = _mm256_and_si256(d[3], mask26), d[4] = _mm256_add_epi64(d[4], c);
+    }
+    // 4个连续块拆为26位五段累加到各路
+    __attribute__((target("avx2"))) static void load4(const uint8_t *p, __m256i h[5])
+    {
+        const __m256i mask26 = _mm256_set1_epi64x(0x3ffffff);
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32));
+        __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+        __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+        h[0] = _mm256_add_epi64(h[0], _mm256_and_si256(lo, mask26));
+        h[1] = _mm256_add_epi64(h[1], _mm256_and_si256(_mm256_srli_epi64(lo, 26), mask26));
+        h[2] = _mm256_add_epi64(h[2], _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo, 52), _mm256_slli_epi64(hi, 12)), mask26));
+        h[3] = _mm256_add_epi64(h[3], _mm256_and_si256(_mm256_srli_epi64(hi, 14), mask26));
+        h[4] = _mm256_add_epi64(h[4], _mm256_or_si256(_mm256_srli_epi64(hi, 40), _mm256_set1_epi64x(1 << 24)));
+    }
+    // n为64的倍数且不为0，只处理完整的消息块
+    __attribute__((target("avx2"))) void blocks4(const uint8_t *p, size_t n)
+    {
+        if (!rpowReady_)
+            powers();
+        __m256i r[5], s[5], h[5], d[5];
+        for (int i = 0; i < 5; ++i)
+        {
+            r[i] = _mm256_set1_epi64x(rpow_[3][i]);
+            s[i] = _mm256_set1_epi64x(rpow_[3][i] * 5ULL);
+        }
+        uint64_t t[5];
+        carry44(h_);
+        to26(h_, t);
+        for (int i = 0; i < 5; ++i)
+            h[i] = _mm256_set_epi64x(0, 0, 0, static_cast<long long>(t[i]));
+        load4(p, h);
+        for (p += 64, n -= 64; n > 0; p += 64, n -= 64)
+        {
+            mul4(h, r, s, d);
+            carry4(d);
+            load4(p, d);
+            memcpy(h, d, sizeof(h));
+        }
+        for (int i = 0; i < 5; ++i)
+        {
+            r[i] = _mm256_set_epi64x(rpow_[0][i], rpow_[1][i], rpow_[2][i], rpow_[3][i]);
+            s[i] = _mm256_mul_epu32(r[i], _mm256_set1_epi64x(5));
+        }
+        mul4(h, r, s, d);
+        carry4(d);
+        for (int i = 0; i < 5; ++i)
+        {
+            __m128i v = _mm_add_epi64(_mm256_castsi256_si128(d[i]), _mm256_extracti128_si256(d[i], 1));
+            t[i] = static_cast<uint64_t>(_mm_cvtsi128_si64(v)) + static_cast<uint64_t>(_mm_extract_epi64(v, 1));
+        }
+        const uint64_t mask26 = 0x3ffffff;
+        uint64_t c;
+        c = t[0] >> 26, t[0] &= mask26, t[1] += c;
+        c = t[1] >> 26, t[1] &= mask26, t[2] += c;
+        c = t[2] >> 26, t[2] &= mask26, t[3] += c;
+        c = t[3] >> 26, t[3] &= mask26, t[4] += c;
+        c = t[4] >> 26, t[4] &= mask26, t[0] += c * 5;
+        c = t[0] >> 26, t[0] &= mask26, t[1] += c;
+        from26(t, h_);
+    }
+#endif
+};
+
+// RFC 8439 ChaCha20-Poly1305 AEAD，原地加解密，标签单独存放
+// 按CRYPT_CHUNK_SIZE分块交替加密与认证，每块只从内存读写一次
+class Aead
+{
+public:
+    static void seal(const uint8_t key[CRYPT_KEY_SIZE], const uint8_t nonce[12], uint8_t *data, size_t n, uint8_t tag[CRYPT_TAG_SIZE])
+    {
+        uint8_t polyKey[64];
+        ChaCha20::block(key, nonce, 0, polyKey);
+        Poly1305 poly(polyKey);
+        uint32_t counter = 1;
+        for (size_t off = 0; off < n; off += CRYPT_CHUNK_SIZE, counter += CRYPT_CHUNK_SIZE / 64)
+        {
+            size_t take = n - off < CRYPT_CHUNK_SIZE ? n - off : CRYPT_CHUNK_SIZE;
+            ChaCha20::xorStream(key, nonce, counter, data + off, take);
+            poly.update(data + off, take);
+        }
+        finish(poly, n, tag);
+    }
+    // 认证失败时data保持密文（边认证边解密，失败时再加密一遍恢复）
+    // rt:
+    //   0   sucess
+    //   -1  authentication failed
+    static int open(const uint8_t key[CRYPT_KEY_SIZE], const uint8_t nonce[12], uint8_t *data, size_t n, const uint8_t tag[CRYPT_TAG_SIZE])
+    {
+        uint8_t polyKey[64];
+        ChaCha20::block(key, nonce, 0, polyKey);
+        Poly1305 poly(polyKey);
+        uint32_t counter = 1;
+        for (size_t off = 0; off < n; off += CRYPT_CHUNK_SIZE, counter += CRYPT_CHUNK_SIZE / 64)
+        {
+            size_t take = n - off < CRYPT_CHUNK_SIZE ? n - off : CRYPT_CHUNK_SIZE;
+            poly.update(data + off, take);
+            ChaCha20::xorStream(key, nonce, counter, data + off, take);
+        }
+        uint8_t expect[CRYPT_TAG_SIZE];
+        finish(poly, n, expect);
+        uint8_t diff = 0;
+        for (int i = 0; i < CRYPT_TAG_SIZE; ++i) // 常数时间比较
+            diff |= expect[i] ^ tag[i];
+        if (0 != diff)
+        {
+            ChaCha20::xorStream(key, nonce, 1, data, n);
+            return -1;
+        }
+        return 0;
+    }
+
+private:
+    static_assert(0 == CRYPT_CHUNK_SIZE % 64, "CRYPT_CHUNK_SIZE must be a multiple of the ChaCha20 block size");
+    // 无附加数据，密文之后补零并追加两个长度
+    static void finish(Poly1305 &poly, size_t n, uint8_t tag[CRYPT_TAG_SIZE])
+    {
+        poly.pad16();
+        uint64_t lens[2] = {0, static_cast<uint64_t>(n)};
+        poly.update(reinterpret_cast<const uint8_t *>(lens), sizeof(lens));
+        poly.finish(tag);
+    }
+};
+
+// 一条连接的加密会话：双方以预共享密钥和握手中交换的随机数派生两个方向各自的密钥，
+// nonce为该方向的帧序号（TCP保序，不随帧发送），因此每帧只多出CRYPT_TAG_SIZE字节
+class CryptSession
+{
+    CryptKey sendKey_;
+    CryptKey recvKey_;
+    uint64_t sendSeq_;
+    uint64_t recvSeq_;
+
+public:
+    CryptSession(const CryptKey &psk, const uint8_t clientRandom[CRYPT_RANDOM_SIZE], const uint8_t serverRandom[CRYPT_RANDOM_SIZE], bool isServer)
+        : sendSeq_(0), recvSeq_(0)
+    {
+        static const uint8_t c2s[16] = {'b', 'b', 'g', ' ', 'c', 'l', 'i', '-', '>', 's', 'e', 'r', 0, 0, 0, 0};
+        static const uint8_t s2c[16] = {'b', 'b', 'g', ' ', 's', 'e', 'r', '-', '>', 'c', 'l', 'i', 0, 0, 0, 0};
+        uint8_t k[CRYPT_KEY_SIZE];
+        uint8_t master[CRYPT_KEY_SIZE];
+        ChaCha20::hchacha(psk.data(), clientRandom, k);
+        ChaCha20::hchacha(k, serverRandom, master);
+        ChaCha20::hchacha(master, isServer ? s2c : c2s, sendKey_.data());
+        ChaCha20::hchacha(master, isServer ? c2s : s2c, recvKey_.data());
+    }
+    ~CryptSession() = default;
+    CryptSession(const CryptSession &) = delete;
+    CryptSession &operator=(const CryptSession &) = delete;
+    CryptSession(CryptSession &&) = delete;
+    CryptSession &operator=(CryptSession &&) = delete;
+    // 必须按发送顺序调用
+    void seal(uint8_t *data, size_t n, uint8_t tag[CRYPT_TAG_SIZE])
+    {
+        uint8_t nonce[12];
+        makeNonce(sendSeq_++, nonce);
+        Aead::seal(sendKey_.data(), nonce, data, n, tag);
+    }
+    // 必须按接收顺序调用，失败后连接应关闭
+    // rt:
+    //   0   sucess
+    //   -1  authentication failed
+    int open(uint8_t *data, size_t n, const uint8_t tag[CRYPT_TAG_SIZE])
+    {
+        uint8_t nonce[12];
+        makeNonce(recvSeq_++, nonce);
+        return Aead::open(recvKey_.data(), nonce, data, n, tag);
+    }
+    // 64个十六进制字符
+    // rt:
+    //   0   sucess
+    //   -1  malformed
+    static int keyFromHex(std::string_view hex, CryptKey &key)
+    {
+        if (hex.size() != 2 * CRYPT_KEY_SIZE)
+            return -1;
+        for (size_t i = 0; i < hex.size(); ++i)
+        {
+            char c = hex[i];
+            int v;
+            if (c >= '0' && c <= '9')
+                v = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                v = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                v = c - 'A' + 10;
+            else
+                return -1;
+            key[i / 2] = static_cast<uint8_t>((i & 1) ? (key[i / 2] | v) : (v << 4));
+        }
+        return 0;
+    }
+    static void randomBytes(uint8_t *p, size_t n)
+    {
+        while (n > 0)
+        {
+            ssize_t got = getrandom(p, n, 0);
+            if (got < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("getrandom failed");
+            }
+            p += got;
+            n -= static_cast<size_t>(got);
+        }
+    }
+
+private:
+    static void makeNonce(uint64_t seq, uint8_t nonce[12])
+    {
+        memset(nonce, 0, 4);
+        memcpy(nonce + 4, &seq, 8);
+    }
+};
+
+#endif
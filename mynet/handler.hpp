@@ -1,15 +1,116 @@
 #include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <iostream>
+#include "message.hpp"
 
 #ifndef HANDLER_HPP
 #define HANDLER_HPP
 
-class Handler
+// 客户端压缩消息解压后的负载上限（Byte），与未压缩帧的上限MAX_FRAME_SIZE相同
+#define MAX_INBOUND_PAYLOAD_SIZE (64 * 1024)
+
+// 处理结果，由所属SubReactor在I/O线程中执行
+struct Outgoing
+{
+    enum Target : uint8_t
+    {
+        REPLY,    // 只发给来源连接
+        BROADCAST // 发给所有连接（可排除来源连接）
+    };
+    Target target;
+    bool coalesce;    // 可合并的状态帧，客户端落后时同一来源同一类型只保留最新一帧
+    bool includeSelf; // BROADCAST是否也发给来源连接
+    int fd;           // 来源连接，服务端自身发出的为-1
+    std::string msg;
+    // 合并状态帧的key：消息类型 + 来源连接
+    uint64_t coalesceKey() const
+    {
+        return (static_cast<uint64_t>(static_cast<uint8_t>(msg[0])) << 32) | static_cast<uint32_t>(fd + 1);
+    }
+};
+
+class Session
 {
+    int fd_;
+    std::vector<Outgoing> &out_;
+
 public:
-    std::string process(const std::string &data)
+    Session(int fd, std::vector<Outgoing> &out) : fd_(fd), out_(out) {}
+    ~Session() = default;
+    Session(const Session &) = delete;
+    Session &operator=(const Session &) = delete;
+    Session(Session &&) = delete;
+    Session &operator=(Session &&) = delete;
+    int getFd() const { return fd_; }
+    void reply(uint8_t type, std::string_view payload, bool coalesce = false)
     {
-        return {};
+        out_.push_back({Outgoing::REPLY, coalesce, true, fd_, Message::encode(type, payload)});
+    }
+    void broadcast(uint8_t type, std::string_view payload, bool coalesce = false, bool includeSelf = true)
+    {
+        out_.push_back({Outgoing::BROADCAST, coalesce, includeSelf, fd_, Message::encode(type, payload)});
     }
 };
 
-#endif
\ No newline at end of file
+// rt:
+//   0   handled
+//   1   deferred, the same frame is dispatched again on the next loop and later frames of this connection wait behind it
+//   -1  close the connection
+using HandlerFunc = int (*)(Session &session, std::string_view payload);
+// 连接关闭后在所属SubReactor线程中调用，不可阻塞
+using CloseFunc = void (*)(int fd);
+
+// 以消息类型为下标的函数指针表分发，必须在构造Reactor之前注册！
+class Handler
+{
+    static std::array<HandlerFunc, MAX_MSG_TYPE_NUM> table_;
+    static inline CloseFunc onClose_ = nullptr;
+
+public:
+    static void registerHandler(uint8_t type, HandlerFunc func) { table_[type] = func; }
+    static void registerCloseHandler(CloseFunc func) { onClose_ = func; }
+    void onClose(int fd) const
+    {
+        if (nullptr != onClose_)
+            onClose_(fd);
+    }
+    // rt:
+    //   0   handled
+    //   1   deferred
+    //   -1  close the connection
+    //   -2  malformed or unknown message, ignored
+    int process(int fd, const std::string &data, std::vector<Outgoing> &out) const
+    {
+        MsgHeader header;
+        std::string_view payload;
+        std::string buf; // 仅压缩消息使用
+        if (0 != Message::decode(data, header, payload, buf, MAX_INBOUND_PAYLOAD_SIZE))
+            return -2;
+        HandlerFunc func = table_[header.type];
+        if (nullptr == func) // 不输出日志，任何客户端都可以发送未知类型刷屏
+            return -2;
+        Session session(fd, out);
+        return func(session, payload);
+    }
+
+private:
+    static std::array<HandlerFunc, MAX_MSG_TYPE_NUM> defaultTable()
+    {
+        std::array<HandlerFunc, MAX_MSG_TYPE_NUM> table{};
+        table[MSG_ECHO] = [](Session &session, std::string_view payload)
+        {
+            session.reply(MSG_ECHO, payload);
+            return 0;
+        };
+        table[MSG_PLAYER_STATE] = [](Session &session, std::string_view payload)
+        {
+            session.broadcast(MSG_PLAYER_STATE, payload, true, false);
+            return 0;
+        };
+        return table;
+    }
+};
+inline std::array<HandlerFunc, MAX_MSG_TYPE_NUM> Handler::table_ = Handler::defaultTable();
+#endif
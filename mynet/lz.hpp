@@ -0,0 +1,201 @@
+#include <string>
+#include <string_view>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef LZ_HPP
+#define LZ_HPP
+
+// 哈希表位数，表大小为(1 << LZ_HASH_BITS)个uint32_t，放在栈上
+#define LZ_HASH_BITS 12
+// 最短匹配长度（Byte）
+#define LZ_MIN_MATCH 4
+// 输入末尾必须保留为字面量的字节数
+#define LZ_LAST_LITERALS 5
+// 距输入末尾少于此长度时不再查找匹配
+#define LZ_MATCH_FIND_LIMIT 12
+// 连续未命中时步长加速的程度，越小越快、压缩率越低
+#define LZ_SKIP_TRIGGER 6
+// 每个输入字节最多展开成的输出字节数（长度扩展字节每个代表255），解压前据此拒绝虚报的原始长度
+#define LZ_MAX_EXPANSION 255
+
+// LZ4块格式的单遍贪心压缩，输出为4字节原始长度 + LZ4块，只依赖本文件
+// 编码：token(高4位字面量长度，低4位匹配长度-4) + [长度扩展255...] + 字面量 + 2字节小端偏移 + [长度扩展255...]
+// 最后一个序列只有字面量
+class Lz
+{
+public:
+    // 压缩结果追加到dst
+    static void compress(std::string_view src, std::string &dst)
+    {
+        const uint32_t n = static_cast<uint32_t>(src.size());
+        size_t base = dst.size();
+        dst.resize(base + 4 + bound(n));
+        memcpy(dst.data() + base, &n, 4);
+        uint8_t *op = reinterpret_cast<uint8_t *>(dst.data() + base + 4);
+        uint8_t *const ostart = op;
+        const uint8_t *const in = reinterpret_cast<const uint8_t *>(src.data());
+        uint32_t anchor = 0;
+        if (n >= LZ_MATCH_FIND_LIMIT + 1)
+        {
+            uint32_t table[1 << LZ_HASH_BITS]; // 位置 + 1，0表示空
+            memset(table, 0, sizeof(table));
+            const uint32_t mflimit = n - LZ_MATCH_FIND_LIMIT;
+            const uint32_t matchlimit = n - LZ_LAST_LITERALS;
+            uint32_t ip = 0;
+            uint32_t searches = 1u << LZ_SKIP_TRIGGER;
+            while (ip < mflimit)
+            {
+                uint32_t seq = read32(in + ip);
+                uint32_t &slot = table[hash(seq)];
+                uint32_t ref = slot;
+                slot = ip + 1;
+                if (0 == ref-- || ip - ref > 0xFFFF || read32(in + ref) != seq)
+                {
+                    ip += searches++ >> LZ_SKIP_TRIGGER;
+                    continue;
+                }
+                searches = 1u << LZ_SKIP_TRIGGER;
+                while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1]) // 向前扩展
+                {
+                    --ip;
+                    --ref;
+                }
+                uint32_t len = matchLength(in, ip, ref, matchlimit);
+                op = emitSequence(op, in + anchor, ip - anchor, static_cast<uint16_t>(ip - ref), len);
+                ip += len;
+                anchor = ip;
+                if (ip >= 2 && ip - 2 < mflimit)
+                    table[hash(read32(in + ip - 2))] = ip - 2 + 1;
+            }
+        }
+        op = emitLiterals(op, in + anchor, n - anchor);
+        dst.resize(base + 4 + (op - ostart));
+    }
+    // 结果写入dst（覆盖）
+    // rt:
+    //   0   sucess
+    //   -1  malformed or larger than maxSize
+    static int decompress(std::string_view src, std::string &dst, size_t maxSize)
+    {
+        uint32_t n = 0;
+        if (src.size() < 4)
+            return -1;
+        memcpy(&n, src.data(), 4);
+        if (n > maxSize || n > (src.size() - 4) * LZ_MAX_EXPANSION) // 在分配前拒绝，几个字节的输入不能换来大块内存
+            return -1;
+        dst.resize(n);
+        const uint8_t *ip = reinterpret_cast<const uint8_t *>(src.data()) + 4;
+        const uint8_t *const iend = reinterpret_cast<const uint8_t *>(src.data()) + src.size();
+        uint8_t *const ostart = reinterpret_cast<uint8_t *>(dst.data());
+        uint8_t *op = ostart;
+        uint8_t *const oend = ostart + n;
+        for (;;)
+        {
+            if (ip >= iend)
+                return -1;
+            uint8_t token = *ip++;
+            size_t lit = token >> 4;
+            if (15 == lit && -1 == readLength(ip, iend, lit))
+                return -1;
+            if (static_cast<size_t>(iend - ip) < lit || static_cast<size_t>(oend - op) < lit)
+                return -1;
+            memcpy(op, ip, lit);
+            ip += lit;
+            op += lit;
+            if (ip == iend) // 最后一个序列
+                return op == oend ? 0 : -1;
+            if (iend - ip < 2)
+                return -1;
+            size_t offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            size_t len = token & 15;
+            if (15 == len && -1 == readLength(ip, iend, len))
+                return -1;
+            len += LZ_MIN_MATCH;
+            if (0 == offset || offset > static_cast<size_t>(op - ostart) || static_cast<size_t>(oend - op) < len)
+                return -1;
+            const uint8_t *match = op - offset;
+            if (offset >= len)
+                memcpy(op, match, len);
+            else
+                for (size_t i = 0; i < len; ++i) // 重叠匹配，逐字节复制实现重复
+                    op[i] = match[i];
+            op += len;
+        }
+    }
+    // 最坏情况（不可压缩）下的块长度
+    static size_t bound(size_t n) { return n + n / 255 + 16; }
+
+private:
+    static uint32_t read32(const uint8_t *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return v;
+    }
+    // 已知前LZ_MIN_MATCH字节相同，每次比较8字节
+    static uint32_t matchLength(const uint8_t *in, uint32_t ip, uint32_t ref, uint32_t limit)
+    {
+        uint32_t len = LZ_MIN_MATCH;
+        while (ip + len + 8 <= limit)
+        {
+            uint64_t a, b;
+            memcpy(&a, in + ip + len, 8);
+            memcpy(&b, in + ref + len, 8);
+            if (a != b)
+                return len + (__builtin_ctzll(a ^ b) >> 3); // 小端
+            len += 8;
+        }
+        while (ip + len < limit && in[ip + len] == in[ref + len])
+            ++len;
+        return len;
+    }
+    static uint32_t hash(uint32_t seq) { return (seq * 2654435761u) >> (32 - LZ_HASH_BITS); }
+    static uint8_t *writeLength(uint8_t *op, size_t len)
+    {
+        for (; len >= 255; len -= 255)
+            *op++ = 255;
+        *op++ = static_cast<uint8_t>(len);
+        return op;
+    }
+    // rt:
+    //   0   sucess
+    //   -1  truncated
+    static int readLength(const uint8_t *&ip, const uint8_t *iend, size_t &len)
+    {
+        uint8_t b;
+        do
+        {
+            if (ip >= iend)
+                return -1;
+            b = *ip++;
+            len += b;
+        } while (255 == b);
+        return 0;
+    }
+    static uint8_t *emitSequence(uint8_t *op, const uint8_t *lit, size_t litLen, uint16_t offset, size_t matchLen)
+    {
+        size_t ml = matchLen - LZ_MIN_MATCH;
+        *op++ = static_cast<uint8_t>(((litLen < 15 ? litLen : 15) << 4) | (ml < 15 ? ml : 15));
+        if (litLen >= 15)
+            op = writeLength(op, litLen - 15);
+        memcpy(op, lit, litLen);
+        op += litLen;
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        if (ml >= 15)
+            op = writeLength(op, ml - 15);
+        return op;
+    }
+    static uint8_t *emitLiterals(uint8_t *op, const uint8_t *lit, size_t litLen)
+    {
+        *op++ = static_cast<uint8_t>((litLen < 15 ? litLen : 15) << 4);
+        if (litLen >= 15)
+            op = writeLength(op, litLen - 15);
+        memcpy(op, lit, litLen);
+        return op + litLen;
+    }
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include <string>
+#include <string_view>
+#include <stdint.h>
+#include "lz.hpp"
+
+#ifndef MESSAGE_HPP
+#define MESSAGE_HPP
+
+// 消息头：1字节类型 + 1字节标志，其后为负载，帧尾仍保留Peer约定的'\0'
+// 空帧（只有'\0'）为心跳，不带消息头
+#define MSG_HEADER_SIZE 2
+// 消息类型个数（分发表大小）
+#define MAX_MSG_TYPE_NUM 256
+// 标志位：负载经Lz压缩，消息头不压缩
+#define MSG_FLAG_COMPRESSED 0x01
+// 能力位（MSG_HELLO负载首字节）：可接收压缩消息
+#define MSG_CAP_LZ 0x01
+// 能力位：以预共享密钥加密此后的所有帧，MSG_HELLO负载在能力位后附带CRYPT_RANDOM_SIZE字节随机数
+#define MSG_CAP_CRYPT 0x02
+// 负载小于此长度时不压缩（Byte）
+#define MSG_COMPRESS_MIN_SIZE 256
+// 解压后负载长度上限（Byte），防止恶意的长度字段
+#define MSG_MAX_PAYLOAD_SIZE (16 * 1024 * 1024)
+
+enum MsgType : uint8_t
+{
+    MSG_ECHO = 1,         // 原样回复，用于测延迟
+    MSG_PLAYER_STATE = 2, // 玩家状态，广播给其他客户端，落后时可合并
+    MSG_INPUT = 3,        // 客户端输入命令，由服务端tick循环消费
+    MSG_SNAPSHOT = 4,     // 服务端权威状态快照，落后时可合并
+    MSG_LEAVE = 5,        // 玩家离开通知
+    MSG_JOIN = 6,         // 客户端加入，服务端回复其玩家id
+    MSG_HELLO = 7,        // 连接建立后客户端上报能力位，服务端回复双方共同的能力位，由Reactor处理不经过Handler
+};
+
+struct MsgHeader
+{
+    uint8_t type;
+    uint8_t flags;
+};
+
+class Message
+{
+public:
+    // 编码为消息头 + 负载（不含帧尾'\0'，由发送方追加）
+    static inline std::string encode(uint8_t type, std::string_view payload, uint8_t flags = 0)
+    {
+        std::string msg;
+        msg.reserve(MSG_HEADER_SIZE + payload.size());
+        msg.push_back(static_cast<char>(type));
+        msg.push_back(static_cast<char>(flags));
+        msg.append(payload);
+        return msg;
+    }
+    // msg为encode的结果，负载达到MSG_COMPRESS_MIN_SIZE且压缩后更短时，把置位MSG_FLAG_COMPRESSED的消息写入out
+    // rt:
+    //   0   compressed
+    //   1   not worth compressing, out unchanged
+    static inline int compress(std::string_view msg, std::string &out)
+    {
+        if (msg.size() < MSG_HEADER_SIZE + MSG_COMPRESS_MIN_SIZE || (msg[1] & MSG_FLAG_COMPRESSED))
+            return 1;
+        std::string packed;
+        packed.reserve(MSG_HEADER_SIZE + 4 + Lz::bound(msg.size()));
+        packed.push_back(msg[0]);
+        packed.push_back(static_cast<char>(msg[1] | MSG_FLAG_COMPRESSED));
+        Lz::compress(msg.substr(MSG_HEADER_SIZE), packed);
+        if (packed.size() >= msg.size())
+            return 1;
+        out = std::move(packed);
+        return 0;
+    }
+    // 同decode，负载被压缩时解压到buf，payload指向buf，header.flags中的MSG_FLAG_COMPRESSED被清除
+    // maxSize为解压后负载长度的上限
+    // rt:
+    //   0   sucess
+    //   -1  malformed
+    static inline int decode(std::string_view data, MsgHeader &header, std::string_view &payload, std::string &buf,
+                             size_t maxSize = MSG_MAX_PAYLOAD_SIZE)
+    {
+        if (0 != decode(data, header, payload))
+            return -1;
+        if (!(header.flags & MSG_FLAG_COMPRESSED))
+            return 0;
+        if (0 != Lz::decompress(payload, buf, maxSize))
+            return -1;
+        header.flags &= ~MSG_FLAG_COMPRESSED;
+        payload = buf;
+        return 0;
+    }
+    // data为收到的整帧（含帧尾'\0'），不处理压缩
+    // rt:
+    //   0   sucess
+    //   -1  malformed
+    static inline int decode(std::string_view data, MsgHeader &header, std::string_view &payload)
+    {
+        if (!data.empty() && '\0' == data.back())
+            data.remove_suffix(1);
+        if (data.size() < MSG_HEADER_SIZE)
+            return -1;
+        header.type = static_cast<uint8_t>(data[0]);
+        header.flags = static_cast<uint8_t>(data[1]);
+        payload = data.substr(MSG_HEADER_SIZE);
+        return 0;
+    }
+};
+
+#endif
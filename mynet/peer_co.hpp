@@ -0,0 +1,538 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <optional>
+#include <memory>
+#include <coroutine>
+#include <exception>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include "message.hpp"
+#include "crypt.hpp"
+
+// 协程版TCP客户端，帧格式与Peer_cli一致（4字节长度 + 数据 + '\0'）
+// EventLoop及其上的所有协程只能在同一线程中运行！
+
+#ifndef PEER_CO_HPP
+#define PEER_CO_HPP
+
+// 单一EventLoop最大事件数
+#define CO_MAX_EVENTS_NUM 256
+// 协程客户端单次recv读取块大小（Byte）
+#define CO_RECV_CHUNK_SIZE 4096
+// 协程客户端单帧最大长度（Byte）
+#define CO_MAX_FRAME_SIZE (64 * 1024 * 1024)
+
+template <class T = void>
+class Task;
+
+namespace detail
+{
+    // 结束时对称转移到等待者
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+        template <class Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            auto cont = h.promise().continuation;
+            return cont ? cont : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    struct PromiseBase
+    {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+    template <class T>
+    struct Promise : PromiseBase
+    {
+        std::optional<T> value;
+        Task<T> get_return_object();
+        void return_value(T v) { value = std::move(v); }
+        T result()
+        {
+            if (error)
+                std::rethrow_exception(error);
+            return std::move(*value);
+        }
+    };
+    template <>
+    struct Promise<void> : PromiseBase
+    {
+        Task<void> get_return_object();
+        void return_void() {}
+        void result()
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    };
+}
+
+// 惰性协程，被co_await时才开始执行，结束后恢复等待者
+template <class T>
+class Task
+{
+public:
+    using promise_type = detail::Promise<T>;
+
+private:
+    std::coroutine_handle<promise_type> h_;
+
+public:
+    explicit Task(std::coroutine_handle<promise_type> h) : h_(h) {}
+    ~Task()
+    {
+        if (h_)
+            h_.destroy();
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    Task(Task &&other) : h_(other.h_) { other.h_ = nullptr; }
+    Task &operator=(Task &&other)
+    {
+        if (this != &other)
+            Task(std::move(other)).swap(*this);
+        return *this;
+    }
+    bool await_ready() const { return !h_ || h_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> cont)
+    {
+        h_.promise().continuation = cont;
+        return h_;
+    }
+    T await_resume() { return h_.promise().result(); }
+
+private:
+    void swap(Task &other) { std::swap(h_, other.h_); }
+};
+
+namespace detail
+{
+    template <class T>
+    Task<T> Promise<T>::get_return_object() { return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this)); }
+    inline Task<void> Promise<void>::get_return_object() { return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this)); }
+
+    // spawn用的自销毁协程
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+}
+
+// 基于epoll（边缘触发）的单线程事件循环，驱动fd读写就绪与定时器
+class EventLoop
+{
+    struct FdWaiters
+    {
+        std::coroutine_handle<> reader;
+        std::coroutine_handle<> writer;
+    };
+    struct Timer
+    {
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t seq;
+        std::coroutine_handle<> h;
+        bool operator>(const Timer &other) const
+        {
+            return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+        }
+    };
+
+    int epoll_fd_;
+    bool is_running_;
+    int aliveTasks_;
+    uint64_t timerSeq_;
+    std::vector<FdWaiters> waiters_; // 以fd为下标
+    std::deque<std::coroutine_handle<>> ready_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+
+public:
+    EventLoop()
+        : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+          is_running_(false),
+          aliveTasks_(0),
+          timerSeq_(0)
+    {
+        if (-1 == epoll_fd_)
+            throw std::runtime_error("epoll_create1 failed");
+    }
+    ~EventLoop() { ::close(epoll_fd_); }
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+    EventLoop(EventLoop &&) = delete;
+    EventLoop &operator=(EventLoop &&) = delete;
+    // 立即开始执行，直到第一次挂起；run()在所有spawn的协程结束后返回
+    void spawn(Task<void> task)
+    {
+        ++aliveTasks_;
+        runDetached(std::move(task));
+    }
+    void stop() { is_running_ = false; }
+    int getAliveTasks() const { return aliveTasks_; }
+    void run()
+    {
+        epoll_event events[CO_MAX_EVENTS_NUM];
+        is_running_ = true;
+        while (is_running_ && aliveTasks_ > 0)
+        {
+            while (!ready_.empty())
+            {
+                auto h = ready_.front();
+                ready_.pop_front();
+                h.resume();
+            }
+            int timeout = -1;
+            if (!timers_.empty())
+            {
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(timers_.top().deadline - std::chrono::steady_clock::now()).count();
+                timeout = wait > 0 ? static_cast<int>(wait) : 0;
+            }
+            if (aliveTasks_ == 0)
+                break;
+            int n = epoll_wait(epoll_fd_, events, CO_MAX_EVENTS_NUM, timeout);
+            if (-1 == n && errno != EINTR)
+            {
+                perror("epoll_wait");
+                break;
+            }
+            for (int i = 0; i < n; ++i)
+            {
+                int fd = events[i].data.fd;
+                if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+                    resumeWaiter(fd, false);
+                if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+                    resumeWaiter(fd, true);
+            }
+            auto now = std::chrono::steady_clock::now();
+            while (!timers_.empty() && timers_.top().deadline <= now)
+            {
+                auto h = timers_.top().h;
+                timers_.pop();
+                h.resume();
+            }
+        }
+        is_running_ = false;
+    }
+    // rt:
+    //   0   sucess
+    //   -1  epoll_ctl failed
+    int add(int fd)
+    {
+        if (static_cast<size_t>(fd) >= waiters_.size())
+            waiters_.resize(fd + 1);
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        return -1 == epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) ? -1 : 0;
+    }
+    // 移除fd，仍在等待的协程会在下一轮被恢复（其I/O随后失败）
+    void remove(int fd)
+    {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        if (static_cast<size_t>(fd) >= waiters_.size())
+            return;
+        FdWaiters &w = waiters_[fd];
+        if (w.reader)
+            ready_.push_back(w.reader);
+        if (w.writer)
+            ready_.push_back(w.writer);
+        w.reader = w.writer = nullptr;
+    }
+    auto readable(int fd) { return IoAwaiter{*this, fd, false}; }
+    auto writable(int fd) { return IoAwaiter{*this, fd, true}; }
+    auto sleep(std::chrono::steady_clock::duration duration) { return SleepAwaiter{*this, std::chrono::steady_clock::now() + duration}; }
+    auto sleepUntil(std::chrono::steady_clock::time_point deadline) { return SleepAwaiter{*this, deadline}; }
+
+private:
+    struct IoAwaiter
+    {
+        EventLoop &loop;
+        int fd;
+        bool write;
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            FdWaiters &w = loop.waiters_[fd];
+            (write ? w.writer : w.reader) = h;
+        }
+        void await_resume() const {}
+    };
+    struct SleepAwaiter
+    {
+        EventLoop &loop;
+        std::chrono::steady_clock::time_point deadline;
+        bool await_ready() const { return deadline <= std::chrono::steady_clock::now(); }
+        void await_suspend(std::coroutine_handle<> h) { loop.timers_.push({deadline, loop.timerSeq_++, h}); }
+        void await_resume() const {}
+    };
+    void resumeWaiter(int fd, bool write)
+    {
+        if (static_cast<size_t>(fd) >= waiters_.size())
+            return;
+        auto &slot = write ? waiters_[fd].writer : waiters_[fd].reader;
+        auto h = slot;
+        slot = nullptr;
+        if (h)
+            h.resume();
+    }
+    detail::Detached runDetached(Task<void> task)
+    {
+        try
+        {
+            co_await task;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "coroutine exited with exception: " << e.what() << std::endl;
+        }
+        --aliveTasks_;
+    }
+};
+
+class Peer_cli_co
+{
+    EventLoop &loop_;
+    int ur_fd_;
+    std::string inBuf_;
+    size_t inPos_;
+    std::unique_ptr<CryptSession> crypt_; // hello协商出加密后非空
+
+public:
+    explicit Peer_cli_co(EventLoop &loop) : loop_(loop), ur_fd_(-1), inPos_(0) {}
+    ~Peer_cli_co() { disconn(); }
+    Peer_cli_co(const Peer_cli_co &) = delete;
+    Peer_cli_co &operator=(const Peer_cli_co &) = delete;
+    Peer_cli_co(Peer_cli_co &&) = delete;
+    Peer_cli_co &operator=(Peer_cli_co &&) = delete;
+    bool isConn() const { return -1 != ur_fd_; }
+    int getFd() const { return ur_fd_; }
+    void disconn()
+    {
+        if (-1 == ur_fd_)
+            return;
+        loop_.remove(ur_fd_);
+        ::close(ur_fd_);
+        ur_fd_ = -1;
+        inBuf_.clear();
+        inPos_ = 0;
+        crypt_.reset();
+    }
+    Task<bool> conn(std::string ur_ip, int ur_port)
+    {
+        disconn();
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (-1 == fd)
+            co_return false;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in ur_sockaddr_in{};
+        ur_sockaddr_in.sin_family = AF_INET;
+        ur_sockaddr_in.sin_addr.s_addr = inet_addr(ur_ip.c_str());
+        ur_sockaddr_in.sin_port = htons(ur_port);
+        if (-1 == loop_.add(fd))
+        {
+            ::close(fd);
+            co_return false;
+        }
+        ur_fd_ = fd;
+        if (-1 == connect(fd, (const sockaddr *)&ur_sockaddr_in, sizeof(sockaddr_in)))
+        {
+            if (errno != EINPROGRESS)
+            {
+                disconn();
+                co_return false;
+            }
+            co_await loop_.writable(fd);
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (ur_fd_ != fd || -1 == getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) || 0 != err)
+            {
+                disconn();
+                co_return false;
+            }
+        }
+        co_return true;
+    }
+    Task<bool> send(std::string data)
+    {
+        if (!isConn())
+            co_return false;
+        uint32_t len = data.size() + 1;
+        std::string frame;
+        frame.reserve(4 + len);
+        frame.append(reinterpret_cast<const char *>(&len), 4);
+        frame.append(data);
+        frame.push_back('\0');
+        if (crypt_) // 须在第一次co_await之前，保证加密顺序与调用顺序一致
+        {
+            frame.resize(frame.size() + CRYPT_TAG_SIZE);
+            uint8_t *body = reinterpret_cast<uint8_t *>(frame.data() + 4);
+            crypt_->seal(body, len, body + len);
+            len += CRYPT_TAG_SIZE;
+            memcpy(frame.data(), &len, 4);
+        }
+        size_t sum = 0;
+        while (sum < frame.size())
+        {
+            if (!isConn())
+                co_return false;
+            ssize_t n = ::send(ur_fd_, frame.data() + sum, frame.size() - sum, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    co_await loop_.writable(ur_fd_);
+                    continue;
+                }
+                disconn();
+                co_return false;
+            }
+            sum += static_cast<size_t>(n);
+        }
+        co_return true;
+    }
+    // 失败或连接断开时返回空
+    Task<std::string> recv()
+    {
+        for (;;)
+        {
+            if (inBuf_.size() - inPos_ >= 4)
+            {
+                uint32_t len = 0;
+                memcpy(&len, inBuf_.data() + inPos_, 4);
+                if (len > CO_MAX_FRAME_SIZE)
+                {
+                    disconn();
+                    co_return std::string();
+                }
+                if (inBuf_.size() - inPos_ - 4 >= len)
+                {
+                    size_t size = len;
+                    if (crypt_)
+                    {
+                        uint8_t *body = reinterpret_cast<uint8_t *>(inBuf_.data() + inPos_ + 4);
+                        if (len <= CRYPT_TAG_SIZE || 0 != crypt_->open(body, len - CRYPT_TAG_SIZE, body + len - CRYPT_TAG_SIZE))
+                        {
+                            disconn();
+                            co_return std::string();
+                        }
+                        size -= CRYPT_TAG_SIZE;
+                    }
+                    std::string data(inBuf_.data() + inPos_ + 4, size);
+                    inPos_ += 4 + len;
+                    if (inPos_ == inBuf_.size())
+                    {
+                        inBuf_.clear();
+                        inPos_ = 0;
+                    }
+                    co_return data;
+                }
+            }
+            if (!isConn())
+                co_return std::string();
+            if (inPos_ > 0)
+            {
+                inBuf_.erase(0, inPos_);
+                inPos_ = 0;
+            }
+            size_t old = inBuf_.size();
+            inBuf_.resize(old + CO_RECV_CHUNK_SIZE);
+            ssize_t n = ::recv(ur_fd_, inBuf_.data() + old, CO_RECV_CHUNK_SIZE, 0);
+            inBuf_.resize(old + (n > 0 ? n : 0));
+            if (0 == n)
+            {
+                disconn();
+                co_return std::string();
+            }
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    co_await loop_.readable(ur_fd_);
+                    continue;
+                }
+                disconn();
+                co_return std::string();
+            }
+        }
+    }
+    // 连接后首先调用，上报能力位并等待服务端回复，回复前收到的帧被丢弃
+    // 请求MSG_CAP_CRYPT时须提供psk，协商成功后此后的帧全部加密
+    // rt:
+    //   >=0 capability bits granted by the server
+    //   -1  disconnected
+    Task<int> hello(uint8_t caps, const CryptKey *psk = nullptr)
+    {
+        if (nullptr == psk)
+            caps &= ~MSG_CAP_CRYPT;
+        std::string payload(1, static_cast<char>(caps));
+        uint8_t clientRandom[CRYPT_RANDOM_SIZE];
+        if (caps & MSG_CAP_CRYPT)
+        {
+            CryptSession::randomBytes(clientRandom, sizeof(clientRandom));
+            payload.append(reinterpret_cast<const char *>(clientRandom), sizeof(clientRandom));
+        }
+        bool sent = co_await send(Message::encode(MSG_HELLO, payload));
+        if (!sent)
+            co_return -1;
+        for (;;)
+        {
+            std::string data = co_await recv();
+            if (data.empty())
+                co_return -1;
+            MsgHeader header;
+            std::string_view reply;
+            if (0 != Message::decode(data, header, reply) || MSG_HELLO != header.type || reply.empty())
+                continue;
+            uint8_t granted = static_cast<uint8_t>(reply[0]) & caps;
+            if (granted & MSG_CAP_CRYPT)
+            {
+                if (reply.size() != 1 + CRYPT_RANDOM_SIZE)
+                {
+                    disconn();
+                    co_return -1;
+                }
+                crypt_ = std::make_unique<CryptSession>(*psk, clientRandom, reinterpret_cast<const uint8_t *>(reply.data() + 1), false);
+            }
+            co_return granted;
+        }
+    }
+    Task<std::string> interact(std::string data)
+    {
+        bool sent = co_await send(std::move(data)); // gcc12下co_await直接写在if条件中会被错误编译
+        if (!sent)
+            co_return std::string();
+        co_return co_await recv();
+    }
+};
+
+#endif
@@ -1,5 +1,5 @@
 #include "peer.hpp"
-#include "syncQueue_nonblocking.hpp"
+#include "syncQueue_lockfree.hpp"
 #include <arpa/inet.h>
 #include <sys/epoll.h>
 #include <fcntl.h>
@@ -9,7 +9,14 @@
 #include <thread>
 #include <stop_token>
 #include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <sys/eventfd.h>
 #include "handler.hpp"
+#include "connection.hpp"
+#include "timeWheel.hpp"
+#include "workerPool.hpp"
+#include "capture.hpp"
 
 #ifndef REACTOR_HPP
 #define REACTOR_HPP
@@ -18,93 +25,110 @@
 #define SUB_REACTOR_NUM 1
 // 单一SubReactor最大事件数
 #define MAX_EVENTS_NUM 32
+// 时间轮tick间隔（ms）
+#define WHEEL_TICK_MS 100
+// 客户端空闲多久后发送心跳（ms）
+#define HEARTBEAT_INTERVAL_MS 5000
+// 客户端空闲多久后断开（ms）
+#define IDLE_TIMEOUT_MS 15000
+// 服务端最大同时连接数，超过则拒绝并关闭新连接
+#define MAX_CONNECTION_NUM 4096
+// 每次acceptor唤醒最多accept的连接数，其余留在内核backlog中
+#define MAX_ACCEPT_PER_LOOP 64
+// 单一SubReactor跨线程广播信箱容量
+#define MAILBOX_SIZE 4096
+// 处理消息的工作线程个数，0表示在SubReactor线程中直接处理
+#define WORKER_THREAD_NUM 0
+// 单一SubReactor工作线程处理结果队列容量
+#define COMPLETION_QUE_SIZE 4096
+// 服务端支持的能力位，与客户端MSG_HELLO上报的取交集；MSG_CAP_CRYPT还需先setPresharedKey
+#define REACTOR_CAPS (MSG_CAP_LZ | MSG_CAP_CRYPT)
+
+// 工作线程处理完一帧后交回所属SubReactor的结果
+struct Completion
+{
+    int fd = -1;
+    uint64_t serial = 0;
+    int rt = 0;
+    std::string data; // 被延后时交回原帧
+    std::vector<Outgoing> out;
+};
 
 class Reactor : public Peer_ser // TCP Server
 {
     int reactor_fd_;
+    int spareFd_; // 预留的fd，进程fd耗尽时释放它来accept并关闭积压的连接
     epoll_event acceptor_;
     std::atomic_flag is_running_;
+    std::atomic<int> connNum_;
+    SyncQueue_lockfree<int> clientQue_; // 须先于subReactorVec_构造、后于其析构
+    std::vector<std::unique_ptr<SyncQueue_lockfree<Outgoing>>> mailboxVec_;
+    std::vector<std::unique_ptr<SyncQueue_lockfree<Completion>>> completionVec_; // 工作线程 -> SubReactor（MPSC）
+    std::vector<int> eventFdVec_;                                                 // 有新结果时唤醒SubReactor
+    std::unique_ptr<WorkerPool> workerPool_;                                      // 为空则不使用工作线程
+    std::unique_ptr<CaptureWriter> capture_;                                      // 为空则不抓包
+    CryptKey psk_;                                                                // 加密会话的预共享密钥
+    bool hasPsk_ = false;
+    bool requireCrypt_ = false;                                                   // 为true时拒绝未加密连接的业务帧
     std::vector<std::jthread> subReactorVec_;
-    SyncQueue_nonblocking<int> clientQue_;
 
 public:
+    // capturePath非空时把收到的每一帧连同连接建立、关闭事件写入抓包日志，可用bbg_replay回放
     Reactor(const std::string &my_ip,
-            const int my_port)
+            const int my_port,
+            const int workerNum = WORKER_THREAD_NUM,
+            const std::string &capturePath = "")
         : Peer_ser(my_ip, my_port),
-          reactor_fd_(-1)
+          reactor_fd_(-1),
+          spareFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+          connNum_(0)
     {
+        if (!capturePath.empty())
+            capture_ = std::make_unique<CaptureWriter>(capturePath);
         if (-1 == fcntl(getFd(), F_SETFL, fcntl(getFd(), F_GETFL, 0) | O_NONBLOCK))
             throw std::runtime_error("fcntl failed");
         reactor_fd_ = epoll_create1(0);
         if (-1 == reactor_fd_)
             throw std::runtime_error("epoll_create1 failed");
-        acceptor_.events = EPOLLIN | EPOLLET;
+        acceptor_.events = EPOLLIN; // 水平触发，限流时未accept的连接下次仍会唤醒
         acceptor_.data.fd = getFd();
         if (-1 == epoll_ctl(reactor_fd_, EPOLL_CTL_ADD, getFd(), &acceptor_))
             throw std::runtime_error("epoll_ctl failed");
+        mailboxVec_.reserve(SUB_REACTOR_NUM);
+        for (int i = 0; i < SUB_REACTOR_NUM; ++i)
+            mailboxVec_.emplace_back(std::make_unique<SyncQueue_lockfree<Outgoing>>(MAILBOX_SIZE));
+        if (workerNum > 0)
+        {
+            completionVec_.reserve(SUB_REACTOR_NUM);
+            eventFdVec_.reserve(SUB_REACTOR_NUM);
+            for (int i = 0; i < SUB_REACTOR_NUM; ++i)
+            {
+                completionVec_.emplace_back(std::make_unique<SyncQueue_lockfree<Completion>>(COMPLETION_QUE_SIZE));
+                eventFdVec_.push_back(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+                if (-1 == eventFdVec_.back())
+                    throw std::runtime_error("eventfd failed");
+            }
+            workerPool_ = std::make_unique<WorkerPool>(workerNum);
+        }
         subReactorVec_.reserve(SUB_REACTOR_NUM);
         for (int i = 0; i < SUB_REACTOR_NUM; ++i)
-            subReactorVec_.emplace_back(std::jthread([this](std::stop_token st)
-                                                     {
-                                                         int subReactor_fd = epoll_create1(0);
-                                                         if (-1 == subReactor_fd)
-                                                             throw std::runtime_error("epoll_create1 failed");
-                                                         epoll_event events[MAX_EVENTS_NUM] = {};
-                                                         epoll_event trigEvents[MAX_EVENTS_NUM] = {};
-                                                         int curNum = 0;
-                                                         auto data = new std::string;
-                                                         Handler handler;
-                                                         while (!st.stop_requested())
-                                                         {
-                                                             int cli_fd = -1;
-                                                             if (0 == getClientQue().take_r(cli_fd))
-                                                             {
-                                                                 events[curNum].events = EPOLLIN | EPOLLET;
-                                                                 events[curNum].data.fd = cli_fd;
-                                                                 if (-1 == epoll_ctl(subReactor_fd, EPOLL_CTL_ADD, cli_fd, &events[curNum]))
-                                                                 {
-                                                                     perror("epoll_ctl");
-                                                                     ::close(cli_fd);
-                                                                 }
-                                                             }
-                                                             int n = epoll_wait(subReactor_fd, trigEvents, MAX_EVENTS_NUM, 10);// 0 millisecond timeout is high performance
-                                                             if (-1 == n)
-                                                             {
-                                                                 perror("epoll_wait");
-                                                                 break;
-                                                             }
-                                                             for (int i = 0; i < n; ++i)
-                                                             {
-                                                                 cli_fd = trigEvents[i].data.fd;
-                                                                 std::string data(recv(cli_fd));
-                                                                 if (data.empty())
-                                                                 {
-                                                                     epoll_ctl(subReactor_fd, EPOLL_CTL_DEL, cli_fd, nullptr);
-                                                                     std::clog << "A client left, fd: " << cli_fd << std::endl;
-                                                                     continue;
-                                                                 }
-                                                                 data = handler.process(data);
-                                                                 if (!send(cli_fd, data))
-                                                                 {
-                                                                     epoll_ctl(subReactor_fd, EPOLL_CTL_DEL, cli_fd, nullptr);
-                                                                     std::cerr << "failed to send to the client, fd: " << cli_fd << std::endl;
-                                                                     continue;
-                                                                 }
-                                                             }
-                                                         }
-                                                         for (int i = 0; i < curNum; ++i)
-                                                             epoll_ctl(subReactor_fd, EPOLL_CTL_DEL, events[i].data.fd, nullptr);
-                                                         delete data;
-                                                         ::close(subReactor_fd);
-                                                         std::clog << "subReactor thread exit" << std::endl; //
-                                                     }));
+            subReactorVec_.emplace_back(std::jthread([this, i](std::stop_token st)
+                                                     { subReactorLoop(st, i); }));
     }
     ~Reactor()
     {
         stop();
         ::close(reactor_fd_);
+        if (-1 != spareFd_)
+            ::close(spareFd_);
         for (auto &t : subReactorVec_)
             t.request_stop();
+        for (auto &t : subReactorVec_)
+            if (t.joinable())
+                t.join();
+        workerPool_.reset(); // 工作线程可能仍在投递结果，须在关闭eventfd前停止
+        for (int efd : eventFdVec_)
+            ::close(efd);
     }
     Reactor(const Reactor &) = delete;
     Reactor &operator=(const Reactor &) = delete;
@@ -116,17 +140,465 @@ public:
         is_running_.test_and_set();
         while (is_running_.test())
         {
-            if (1 == epoll_wait(reactor_fd_, &ev, 1, 10)) // 0 millisecond timeout is high performance
+            if (1 != epoll_wait(reactor_fd_, &ev, 1, 10)) // 0 millisecond timeout is high performance
+                continue;
+            for (int i = 0; i < MAX_ACCEPT_PER_LOOP; ++i)
             {
                 int cli_fd = accept();
+                if (-1 == cli_fd)
+                {
+                    if (EMFILE != errno && ENFILE != errno)
+                        break;
+                    if (shedConnection())
+                        continue;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10)); // 连预留fd也没有时退避，避免空转
+                    break;
+                }
+                if (connNum_.load(std::memory_order_relaxed) >= MAX_CONNECTION_NUM)
+                {
+                    reject(cli_fd);
+                    continue;
+                }
+                if (-1 == fcntl(cli_fd, F_SETFL, fcntl(cli_fd, F_GETFL, 0) | O_NONBLOCK) ||
+                    0 != getClientQue().put_r(cli_fd))
+                {
+                    reject(cli_fd);
+                    continue;
+                }
+                connNum_.fetch_add(1, std::memory_order_relaxed);
                 std::clog << "A new client was accepted, fd: " << cli_fd << std::endl;
-                if (-1 == getClientQue().put_r(cli_fd))
-                    send(cli_fd, "server is busy");
             }
         }
     }
     inline void stop() { is_running_.clear(); }
-    inline SyncQueue_nonblocking<int> &getClientQue() { return clientQue_; }
+    // 设置后客户端可在MSG_HELLO中请求加密，须在run之前调用
+    // required为true时未完成加密协商的连接发来业务帧即被关闭
+    void setPresharedKey(const CryptKey &psk, bool required = false)
+    {
+        psk_ = psk;
+        hasPsk_ = true;
+        requireCrypt_ = required;
+    }
+    inline SyncQueue_lockfree<int> &getClientQue() { return clientQue_; }
+    inline int getConnNum() const { return connNum_.load(std::memory_order_relaxed); }
+    // 任意线程向所有客户端广播，由各SubReactor在下一轮循环中发送
+    // rt:
+    //   0   sucess
+    //   -1  some mailbox is full, dropped there
+    int broadcast_r(uint8_t type, std::string_view payload, bool coalesce = false)
+    {
+        Outgoing o{Outgoing::BROADCAST, coalesce, true, -1, Message::encode(type, payload)};
+        int rt = 0;
+        for (auto &mailbox : mailboxVec_)
+            if (0 != mailbox->put_r(o))
+                rt = -1;
+        return rt;
+    }
+
+private:
+    void subReactorLoop(std::stop_token st, int index)
+    {
+        int subReactor_fd = epoll_create1(0);
+        if (-1 == subReactor_fd)
+            throw std::runtime_error("epoll_create1 failed");
+        epoll_event trigEvents[MAX_EVENTS_NUM] = {};
+        Handler handler;
+        TimeWheel wheel;
+        std::unordered_map<int, Connection> conns;
+        std::vector<Outgoing> out;    // 本轮Handler产生的待发送消息
+        std::vector<int> deferredFds; // 有帧被延后的连接
+        std::vector<int> dirtyFds;    // 本轮写入过输出缓冲的连接
+        std::vector<std::pair<int, const char *>> closingFds; // 本轮需关闭的连接，统一在遍历结束后关闭
+        const uint64_t heartbeatTicks = HEARTBEAT_INTERVAL_MS / WHEEL_TICK_MS;
+        const uint64_t timeoutTicks = IDLE_TIMEOUT_MS / WHEEL_TICK_MS;
+        std::string captureBuf; // 本线程的抓包缓冲
+        // 抓包中的连接号，各SubReactor的serial交错排列以保证全局唯一
+        auto captureId = [&](const Connection &conn)
+        { return static_cast<uint32_t>(conn.getSerial() * SUB_REACTOR_NUM + index); };
+        auto closeClient = [&](int cli_fd, const char *reason)
+        {
+            auto it = conns.find(cli_fd);
+            if (it == conns.end())
+                return;
+            if (capture_)
+                capture_->append(captureBuf, captureId(it->second), CaptureRecord::CLOSE);
+            conns.erase(it);
+            epoll_ctl(subReactor_fd, EPOLL_CTL_DEL, cli_fd, nullptr);
+            wheel.remove(cli_fd);
+            handler.onClose(cli_fd); // 须在close之前，fd关闭后可能立即被新连接复用
+            ::close(cli_fd);
+            connNum_.fetch_sub(1, std::memory_order_relaxed);
+            std::clog << reason << ", fd: " << cli_fd << std::endl;
+        };
+        // 到期时根据空闲时长续期、发心跳或踢出
+        auto onExpire = [&](int cli_fd)
+        {
+            uint64_t idle = wheel.idleTicks(cli_fd);
+            if (idle >= timeoutTicks)
+                closeClient(cli_fd, "A client timed out");
+            else if (idle >= heartbeatTicks)
+            {
+                conns.at(cli_fd).queueState(0, {}); // 心跳为空数据帧，落后时合并
+                dirtyFds.push_back(cli_fd);
+                wheel.schedule(cli_fd, std::min(heartbeatTicks, timeoutTicks - idle));
+            }
+            else
+                wheel.schedule(cli_fd, heartbeatTicks - idle);
+        };
+        // msg为o.msg本身或其压缩形式
+        auto queueTo = [&](Connection &conn, const Outgoing &o, std::string_view msg)
+        {
+            if (o.coalesce)
+                conn.queueState(o.coalesceKey(), msg);
+            else if (-1 == conn.queueFrame(msg))
+            {
+                closingFds.emplace_back(conn.getFd(), "A client fell behind its output quota");
+                return;
+            }
+            dirtyFds.push_back(conn.getFd());
+        };
+        // fromMailbox为其他线程投递来的广播，只发给本SubReactor的连接
+        auto deliver = [&](const Outgoing &o, bool fromMailbox)
+        {
+            // 只压缩一次，由所有协商了压缩的连接共用
+            std::string packed;
+            int packRt = -1;
+            auto pick = [&](Connection &conn) -> std::string_view
+            {
+                if (!(conn.getCaps() & MSG_CAP_LZ))
+                    return o.msg;
+                if (-1 == packRt)
+                    packRt = Message::compress(o.msg, packed);
+                return 0 == packRt ? std::string_view(packed) : std::string_view(o.msg);
+            };
+            if (Outgoing::REPLY == o.target)
+            {
+                auto it = conns.find(o.fd);
+                if (it != conns.end())
+                    queueTo(it->second, o, pick(it->second));
+                return;
+            }
+            for (auto &conn : conns)
+                if (o.includeSelf || conn.first != o.fd)
+                    queueTo(conn.second, o, pick(conn.second));
+            if (!fromMailbox)
+                for (int i = 0; i < SUB_REACTOR_NUM; ++i)
+                    if (i != index && 0 != mailboxVec_[i]->put_r(o))
+                        std::cerr << "subReactor mailbox is full, broadcast dropped" << std::endl;
+        };
+        // rt: 同Handler::process，延后时丢弃本次调用产生的消息
+        auto dispatch = [&](int cli_fd, const std::string &data)
+        {
+            size_t mark = out.size();
+            int rt = handler.process(cli_fd, data, out);
+            if (1 == rt)
+                out.resize(mark);
+            return rt;
+        };
+        uint64_t nextSerial = 0;
+        // 投递到工作线程，结果经completionVec_[index]交回，同一连接同时只有一帧在处理以保序
+        auto submit = [&](Connection &conn, std::string data)
+        {
+            conn.getInFlight() = true;
+            workerPool_->submit_r([this, index, st, fd = conn.getFd(), serial = conn.getSerial(), data = std::move(data)]() mutable
+                                  {
+                                      Completion c;
+                                      c.fd = fd;
+                                      c.serial = serial;
+                                      c.rt = Handler().process(fd, data, c.out);
+                                      if (1 == c.rt)
+                                      {
+                                          c.out.clear();
+                                          c.data = std::move(data);
+                                      }
+                                      // SubReactor停止后不再取结果，丢弃，否则队列满时~Reactor等工作线程退出会卡死
+                                      while (-1 == completionVec_[index]->put_r(std::move(c)))
+                                      {
+                                          if (st.stop_requested())
+                                              return;
+                                          std::this_thread::yield();
+                                      }
+                                      uint64_t one = 1;
+                                      if (-1 == ::write(eventFdVec_[index], &one, sizeof(one)) && errno != EAGAIN)
+                                          perror("eventfd write"); });
+        };
+        // 分发连接等待队列中的帧，直到处理完、被延后或已有帧在工作线程中
+        auto pump = [&](Connection &conn)
+        {
+            auto &waiting = conn.getWaiting();
+            if (workerPool_)
+            {
+                if (!conn.getInFlight() && !waiting.empty())
+                {
+                    std::string data(std::move(waiting.front()));
+                    waiting.pop_front();
+                    submit(conn, std::move(data));
+                }
+                return;
+            }
+            while (!waiting.empty())
+            {
+                int ret = dispatch(conn.getFd(), waiting.front());
+                if (1 == ret)
+                {
+                    deferredFds.push_back(conn.getFd());
+                    return;
+                }
+                waiting.pop_front();
+                if (-1 == ret)
+                {
+                    closingFds.emplace_back(conn.getFd(), "A client was closed by the handler");
+                    return;
+                }
+            }
+        };
+        int eventFd = workerPool_ ? eventFdVec_[index] : -1;
+        if (-1 != eventFd)
+        {
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = eventFd;
+            if (-1 == epoll_ctl(subReactor_fd, EPOLL_CTL_ADD, eventFd, &ev))
+                throw std::runtime_error("epoll_ctl failed");
+        }
+        auto lastTick = std::chrono::steady_clock::now();
+        while (!st.stop_requested())
+        {
+            int cli_fd = -1;
+            while (0 == getClientQue().take_r(cli_fd))
+            {
+                epoll_event ev{};
+                ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                ev.data.fd = cli_fd;
+                if (-1 == epoll_ctl(subReactor_fd, EPOLL_CTL_ADD, cli_fd, &ev))
+                {
+                    perror("epoll_ctl");
+                    ::close(cli_fd);
+                    connNum_.fetch_sub(1, std::memory_order_relaxed);
+                    continue;
+                }
+                auto inserted = conns.insert_or_assign(cli_fd, Connection(cli_fd, ++nextSerial));
+                if (capture_)
+                    capture_->append(captureBuf, captureId(inserted.first->second), CaptureRecord::OPEN);
+                wheel.schedule(cli_fd, heartbeatTicks);
+                wheel.touch(cli_fd);
+            }
+            // 重新分发上一轮被延后的帧
+            if (!deferredFds.empty())
+            {
+                std::vector<int> retry;
+                retry.swap(deferredFds);
+                for (int fd : retry)
+                {
+                    auto it = conns.find(fd);
+                    if (it != conns.end())
+                        pump(it->second);
+                }
+            }
+            int n = epoll_wait(subReactor_fd, trigEvents, MAX_EVENTS_NUM, 10); // 0 millisecond timeout is high performance
+            if (-1 == n)
+            {
+                if (errno == EINTR)
+                    continue;
+                perror("epoll_wait");
+                break;
+            }
+            for (int i = 0; i < n; ++i)
+            {
+                cli_fd = trigEvents[i].data.fd;
+                if (cli_fd == eventFd)
+                {
+                    uint64_t cnt;
+                    while (sizeof(cnt) == ::read(eventFd, &cnt, sizeof(cnt)))
+                        ;
+                    continue;
+                }
+                auto it = conns.find(cli_fd);
+                if (it == conns.end())
+                    continue;
+                Connection &conn = it->second;
+                if (trigEvents[i].events & EPOLLIN)
+                {
+                    bool closing = false;
+                    int rt = conn.readFrames([&](std::string data)
+                                             {
+                                                 if (capture_ && !closing)
+                                                     capture_->append(captureBuf, captureId(conn), CaptureRecord::FRAME, data);
+                                                 if (1 == data.size() || closing) // 心跳，仅刷新活跃时间
+                                                     return;
+                                                 if (isHello(data)) // 传输层协商，立即回复，不经过Handler
+                                                 {
+                                                     if (0 == hello(conn, data))
+                                                         dirtyFds.push_back(cli_fd);
+                                                     return;
+                                                 }
+                                                 if (requireCrypt_ && !conn.isEncrypted())
+                                                 {
+                                                     closingFds.emplace_back(cli_fd, "A client sent a frame without encryption");
+                                                     closing = true;
+                                                     return;
+                                                 }
+                                                 auto &waiting = conn.getWaiting();
+                                                 if (waiting.size() >= MAX_WAITING_FRAME_NUM)
+                                                 {
+                                                     closingFds.emplace_back(cli_fd, "A client has too many pending frames");
+                                                     closing = true;
+                                                     return;
+                                                 }
+                                                 bool idle = waiting.empty() && !conn.getInFlight();
+                                                 waiting.push_back(std::move(data));
+                                                 if (idle)
+                                                     pump(conn); });
+                    wheel.touch(cli_fd);
+                    if (-1 == rt)
+                    {
+                        closingFds.emplace_back(cli_fd, "A client left");
+                        continue;
+                    }
+                    if (-2 == rt)
+                    {
+                        closingFds.emplace_back(cli_fd, "A client sent an oversized frame");
+                        continue;
+                    }
+                    if (-3 == rt)
+                    {
+                        closingFds.emplace_back(cli_fd, "A client failed frame authentication");
+                        continue;
+                    }
+                }
+                if (trigEvents[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+                {
+                    closingFds.emplace_back(cli_fd, "A client left");
+                    continue;
+                }
+                if (trigEvents[i].events & EPOLLOUT)
+                    dirtyFds.push_back(cli_fd);
+            }
+            // 收回工作线程的处理结果
+            if (workerPool_)
+            {
+                Completion c;
+                while (0 == completionVec_[index]->take_r(c))
+                {
+                    auto it = conns.find(c.fd);
+                    if (it == conns.end() || it->second.getSerial() != c.serial) // 连接已关闭
+                        continue;
+                    Connection &conn = it->second;
+                    conn.getInFlight() = false;
+                    if (1 == c.rt)
+                    {
+                        conn.getWaiting().push_front(std::move(c.data));
+                        deferredFds.push_back(c.fd);
+                        continue;
+                    }
+                    for (auto &msg : c.out)
+                        out.push_back(std::move(msg));
+                    if (-1 == c.rt)
+                        closingFds.emplace_back(c.fd, "A client was closed by the handler");
+                    else
+                        pump(conn);
+                }
+            }
+            Outgoing o;
+            while (0 == mailboxVec_[index]->take_r(o))
+                deliver(o, true);
+            for (auto &msg : out)
+                deliver(msg, false);
+            out.clear();
+            auto now = std::chrono::steady_clock::now();
+            while (now - lastTick >= std::chrono::milliseconds(WHEEL_TICK_MS))
+            {
+                lastTick += std::chrono::milliseconds(WHEEL_TICK_MS);
+                wheel.tick(onExpire);
+                if (capture_) // 至多延迟一个时间轮tick落盘
+                    capture_->flush_r(captureBuf, true);
+            }
+            for (int fd : dirtyFds)
+            {
+                auto it = conns.find(fd);
+                if (it != conns.end() && -1 == it->second.flush())
+                    closingFds.emplace_back(fd, "failed to send to the client");
+            }
+            dirtyFds.clear();
+            for (auto &closing : closingFds)
+                closeClient(closing.first, closing.second);
+            closingFds.clear();
+            if (capture_)
+                capture_->flush_r(captureBuf);
+        }
+        if (capture_)
+        {
+            for (auto &conn : conns)
+                capture_->append(captureBuf, captureId(conn.second), CaptureRecord::CLOSE);
+            capture_->flush_r(captureBuf, true);
+        }
+        for (auto &conn : conns)
+            ::close(conn.first);
+        connNum_.fetch_sub(static_cast<int>(conns.size()), std::memory_order_relaxed);
+        ::close(subReactor_fd);
+        std::clog << "subReactor thread exit" << std::endl; //
+    }
+    // 消息头 + 1字节能力位 + [客户端随机数] + 帧尾'\0'
+    static bool isHello(const std::string &data)
+    {
+        return data.size() >= MSG_HEADER_SIZE + 2 && MSG_HELLO == static_cast<uint8_t>(data[0]);
+    }
+    // 回复双方共同的能力位，协商出加密时附带服务端随机数，回复本身不加密，之后的帧全部加密
+    // rt:
+    //   0   sucess
+    //   -1  output buffer quota exceeded
+    int hello(Connection &conn, const std::string &data)
+    {
+        uint8_t caps = static_cast<uint8_t>(data[MSG_HEADER_SIZE]) & REACTOR_CAPS;
+        bool crypt = (caps & MSG_CAP_CRYPT) && hasPsk_ && !conn.isEncrypted() &&
+                     MSG_HEADER_SIZE + 1 + CRYPT_RANDOM_SIZE + 1 == data.size();
+        if (!crypt)
+            caps &= ~MSG_CAP_CRYPT;
+        conn.getCaps() = caps;
+        std::string payload(1, static_cast<char>(caps));
+        uint8_t serverRandom[CRYPT_RANDOM_SIZE];
+        if (crypt)
+        {
+            CryptSession::randomBytes(serverRandom, sizeof(serverRandom));
+            payload.append(reinterpret_cast<const char *>(serverRandom), sizeof(serverRandom));
+        }
+        if (-1 == conn.queueFrame(Message::encode(MSG_HELLO, payload)))
+            return -1;
+        if (crypt)
+        {
+            auto clientRandom = reinterpret_cast<const uint8_t *>(data.data() + MSG_HEADER_SIZE + 1);
+            conn.setCrypt(std::make_unique<CryptSession>(psk_, clientRandom, serverRandom, true));
+        }
+        return 0;
+    }
+    // 拒绝连接：尽力非阻塞地告知客户端后立即关闭，不占用fd
+    // fd耗尽时backlog中的连接取不出来，水平触发的监听fd会让epoll_wait一直立即返回
+    // 释放预留fd后accept一个连接并立即关闭，再重新预留
+    // rt: true 丢弃了一个连接
+    bool shedConnection()
+    {
+        if (-1 == spareFd_)
+            spareFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (-1 == spareFd_)
+            return false;
+        ::close(spareFd_);
+        int cli_fd = ::accept(getFd(), nullptr, nullptr);
+        if (-1 != cli_fd)
+            ::close(cli_fd);
+        spareFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        return -1 != cli_fd;
+    }
+    static void reject(int cli_fd)
+    {
+        static const char busy[] = "server is busy";
+        char frame[4 + sizeof(busy)];
+        uint32_t len = sizeof(busy);
+        memcpy(frame, &len, 4);
+        memcpy(frame + 4, busy, sizeof(busy));
+        ::send(cli_fd, frame, sizeof(frame), MSG_DONTWAIT | MSG_NOSIGNAL);
+        ::close(cli_fd);
+        std::clog << "A new client was rejected, fd: " << cli_fd << std::endl;
+    }
 };
 
 #endif
\ No newline at end of file
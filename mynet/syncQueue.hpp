@@ -1,4 +1,5 @@
-#include <queue>
+#include <vector>
+#include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
@@ -15,17 +16,19 @@
 // 同步队列take最大等待时间（ms）
 #define MAX_TAKE_WAIT_TIME 1000
 
+// 生产者追加到que_，批量take_r时与消费者传入的空vector交换（O(1)，保留双方容量）
 template <class Element>
 class SyncQueue
 {
-    std::queue<Element> que_;
+    std::vector<Element> que_;
+    size_t head_; // 单个take_r的读位置，que_取空后归零
     mutable std::mutex mtx_;
     std::condition_variable cv_que_empty_;
     std::condition_variable cv_que_full_;
     bool is_que_running_;
 
 public:
-    SyncQueue() : is_que_running_(true) {}
+    SyncQueue() : head_(0), is_que_running_(true) {}
     ~SyncQueue() { stop_r(); }
     SyncQueue(const SyncQueue &) = delete;
     SyncQueue &operator=(const SyncQueue &) = delete;
@@ -58,7 +61,7 @@ public:
         }
         if (!is_que_running_)
             return -2;
-        que_.push(std::forward<T>(element));
+        que_.push_back(std::forward<T>(element));
         cv_que_empty_.notify_all();
         return 0;
     }
@@ -74,15 +77,25 @@ public:
                 cv_que_empty_.wait_for(locker, std::chrono::milliseconds(MAX_TAKE_WAIT_TIME)))
                 return -1;
         }
-        element = que_.front();
-        que_.pop();
+        element = std::move(que_[head_++]);
+        if (head_ == que_.size())
+        {
+            que_.clear();
+            head_ = 0;
+        }
+        else if (head_ >= MAX_QUE_SIZE) // 逐个取时生产者未停，压缩已读前缀防止无限增长
+        {
+            que_.erase(que_.begin(), que_.begin() + head_);
+            head_ = 0;
+        }
         cv_que_full_.notify_all();
         return 0;
     }
+    // que会被清空后与内部缓冲交换，反复传入同一个vector可避免每次取出时分配内存
     // rt:
     //   0   sucess
     //   -1  timeout
-    int take_r(std::deque<Element> &que)
+    int take_r(std::vector<Element> &que)
     {
         std::unique_lock<std::mutex> locker(mtx_);
         while (isEmpty())
@@ -91,29 +104,35 @@ public:
                 cv_que_empty_.wait_for(locker, std::chrono::milliseconds(MAX_TAKE_WAIT_TIME)))
                 return -1;
         }
-        que = std::move(que_);
+        que.clear();
+        if (head_ > 0)
+        {
+            que_.erase(que_.begin(), que_.begin() + head_);
+            head_ = 0;
+        }
+        que_.swap(que);
         cv_que_full_.notify_all();
         return 0;
     }
     bool empty_r() const
     {
         std::lock_guard<std::mutex> locker(mtx_);
-        return que_.empty();
+        return isEmpty();
     }
     bool full_r() const
     {
         std::lock_guard<std::mutex> locker(mtx_);
-        return que_.size() >= MAX_QUE_SIZE;
+        return isFull();
     }
     size_t size_r() const
     {
         std::lock_guard<std::mutex> locker(mtx_);
-        return que_.size();
+        return que_.size() - head_;
     }
 
 private:
-    bool isFull() const { return que_.size() >= MAX_QUE_SIZE; }
-    bool isEmpty() const { return que_.empty(); }
+    bool isFull() const { return que_.size() - head_ >= MAX_QUE_SIZE; }
+    bool isEmpty() const { return que_.size() == head_; }
 };
 
 #endif
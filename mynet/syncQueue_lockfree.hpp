@@ -0,0 +1,144 @@
+#include <atomic>
+#include <memory>
+#include <deque>
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SYNCQUEUE_LOCKFREE_HPP
+#define SYNCQUEUE_LOCKFREE_HPP
+
+// 无锁同步队列默认容量（向上取整为2的幂）
+#define LOCKFREE_QUE_SIZE 16384
+// 缓存行大小（Byte）
+#define CACHE_LINE_SIZE 64
+
+// 有界多生产者多消费者无锁队列（Vyukov），返回码与SyncQueue_nonblocking一致
+template <class Element>
+class SyncQueue_lockfree
+{
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        Element element;
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> putPos_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> takePos_;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> is_que_running_;
+
+public:
+    explicit SyncQueue_lockfree(size_t capacity = LOCKFREE_QUE_SIZE)
+        : mask_(roundUpPow2(capacity) - 1),
+          cells_(new Cell[mask_ + 1]),
+          putPos_(0),
+          takePos_(0),
+          is_que_running_(true)
+    {
+        for (size_t i = 0; i <= mask_; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    ~SyncQueue_lockfree()
+    {
+        is_que_running_.store(false, std::memory_order_relaxed);
+        if (!empty_r())
+            std::clog << "sync queue: remaining elements size " << size_r() << std::endl;
+    }
+    SyncQueue_lockfree(const SyncQueue_lockfree &) = delete;
+    SyncQueue_lockfree &operator=(const SyncQueue_lockfree &) = delete;
+    SyncQueue_lockfree(SyncQueue_lockfree &&) = delete;
+    SyncQueue_lockfree &operator=(SyncQueue_lockfree &&) = delete;
+    void stop_r() { is_que_running_.store(false, std::memory_order_relaxed); }
+    // rt:
+    //   0   sucess
+    //   -1  queue is full
+    //   -2  queue stopped
+    template <class T>
+    int put_r(T &&element)
+    {
+        if (!is_que_running_.load(std::memory_order_relaxed))
+            return -2;
+        Cell *cell;
+        size_t pos = putPos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (0 == diff)
+            {
+                if (putPos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return -1;
+            else
+                pos = putPos_.load(std::memory_order_relaxed);
+        }
+        cell->element = std::forward<T>(element);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return 0;
+    }
+    // rt:
+    //   0   sucess
+    //   -1  queue is empty
+    int take_r(Element &element)
+    {
+        Cell *cell;
+        size_t pos = takePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (0 == diff)
+            {
+                if (takePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return -1;
+            else
+                pos = takePos_.load(std::memory_order_relaxed);
+        }
+        element = std::move(cell->element);
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return 0;
+    }
+    // rt:
+    //   0   sucess
+    //   -1  queue is empty
+    int take_r(std::deque<Element> &que)
+    {
+        Element element;
+        if (0 != take_r(element))
+            return -1;
+        que.push_back(std::move(element));
+        while (0 == take_r(element))
+            que.push_back(std::move(element));
+        return 0;
+    }
+    // 以下查询在并发下仅为近似值
+    bool empty_r() const { return 0 == size_r(); }
+    bool full_r() const { return size_r() > mask_; }
+    size_t size_r() const
+    {
+        size_t take = takePos_.load(std::memory_order_relaxed);
+        size_t put = putPos_.load(std::memory_order_relaxed);
+        return put > take ? put - take : 0;
+    }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    static size_t roundUpPow2(size_t n)
+    {
+        size_t cap = 2;
+        while (cap < n)
+            cap <<= 1;
+        return cap;
+    }
+};
+
+#endif
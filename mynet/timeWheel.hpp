@@ -0,0 +1,154 @@
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
+#ifndef TIMEWHEEL_HPP
+#define TIMEWHEEL_HPP
+
+// 时间轮每层槽数的位数
+#define WHEEL_SLOT_BITS 6
+// 时间轮每层槽数
+#define WHEEL_SLOT_NUM (1 << WHEEL_SLOT_BITS)
+// 时间轮层数
+#define WHEEL_LEVEL_NUM 2
+
+// 两层分级时间轮，以fd为下标的侵入式链表，schedule/touch/remove均为O(1)
+// 只能在单一线程（所属SubReactor）中使用！
+class TimeWheel
+{
+    struct Node
+    {
+        int prev = -1;
+        int next = -1;
+        int level = -1; // -1表示未挂在轮上
+        int slot = 0;
+        uint64_t expire = 0;
+        uint64_t lastActive = 0;
+    };
+
+    std::vector<Node> nodes_;
+    int heads_[WHEEL_LEVEL_NUM][WHEEL_SLOT_NUM];
+    uint64_t curTick_;
+
+public:
+    TimeWheel() : curTick_(0)
+    {
+        for (auto &level : heads_)
+            for (auto &head : level)
+                head = -1;
+    }
+    ~TimeWheel() = default;
+    TimeWheel(const TimeWheel &) = delete;
+    TimeWheel &operator=(const TimeWheel &) = delete;
+    TimeWheel(TimeWheel &&) = delete;
+    TimeWheel &operator=(TimeWheel &&) = delete;
+    uint64_t now() const { return curTick_; }
+    // 在ticks个tick后到期（至少1个tick），已在轮上则先移除
+    void schedule(int fd, uint64_t ticks)
+    {
+        assert(fd >= 0);
+        if (static_cast<size_t>(fd) >= nodes_.size())
+            nodes_.resize(fd + 1);
+        unlink(fd);
+        nodes_[fd].expire = curTick_ + (ticks == 0 ? 1 : ticks);
+        link(fd);
+    }
+    // 记录活跃时间，不移动节点，到期时由回调根据空闲时长决定是否续期
+    void touch(int fd)
+    {
+        if (static_cast<size_t>(fd) < nodes_.size())
+            nodes_[fd].lastActive = curTick_;
+    }
+    uint64_t idleTicks(int fd) const
+    {
+        if (static_cast<size_t>(fd) >= nodes_.size())
+            return 0;
+        return curTick_ - nodes_[fd].lastActive;
+    }
+    void remove(int fd)
+    {
+        if (fd >= 0 && static_cast<size_t>(fd) < nodes_.size())
+            unlink(fd);
+    }
+    bool contains(int fd) const
+    {
+        return fd >= 0 && static_cast<size_t>(fd) < nodes_.size() && nodes_[fd].level != -1;
+    }
+    // 前进一个tick，对每个到期的fd调用onExpire(fd)，回调中可再次schedule/remove
+    template <class F>
+    void tick(F &&onExpire)
+    {
+        ++curTick_;
+        int slot = static_cast<int>(curTick_ & (WHEEL_SLOT_NUM - 1));
+        if (0 == slot) // 第二层对应槽降级到第一层
+        {
+            int upper = static_cast<int>((curTick_ >> WHEEL_SLOT_BITS) & (WHEEL_SLOT_NUM - 1));
+            int fd = heads_[1][upper];
+            heads_[1][upper] = -1;
+            while (-1 != fd)
+            {
+                int next = nodes_[fd].next;
+                nodes_[fd].level = -1;
+                link(fd);
+                fd = next;
+            }
+        }
+        int fd = heads_[0][slot];
+        heads_[0][slot] = -1;
+        while (-1 != fd)
+        {
+            int next = nodes_[fd].next;
+            nodes_[fd].level = -1;
+            if (-1 != next)
+                nodes_[next].prev = -1;
+            onExpire(fd); // 回调只可能改动fd本身，next仍然有效
+            fd = next;
+        }
+    }
+
+private:
+    void link(int fd)
+    {
+        Node &node = nodes_[fd];
+        uint64_t delta = node.expire > curTick_ ? node.expire - curTick_ : 0;
+        const uint64_t maxDelta = static_cast<uint64_t>(WHEEL_SLOT_NUM) * (WHEEL_SLOT_NUM - 1);
+        if (delta > maxDelta) // 超出范围的按最大值处理，到期后由回调续期
+        {
+            delta = maxDelta;
+            node.expire = curTick_ + delta;
+        }
+        if (delta < WHEEL_SLOT_NUM)
+        {
+            node.level = 0;
+            node.slot = static_cast<int>(node.expire & (WHEEL_SLOT_NUM - 1));
+        }
+        else
+        {
+            node.level = 1;
+            node.slot = static_cast<int>((node.expire >> WHEEL_SLOT_BITS) & (WHEEL_SLOT_NUM - 1));
+        }
+        int &head = heads_[node.level][node.slot];
+        node.prev = -1;
+        node.next = head;
+        if (-1 != head)
+            nodes_[head].prev = fd;
+        head = fd;
+    }
+    void unlink(int fd)
+    {
+        Node &node = nodes_[fd];
+        if (-1 == node.level)
+            return;
+        if (-1 != node.prev)
+            nodes_[node.prev].next = node.next;
+        else
+            heads_[node.level][node.slot] = node.next;
+        if (-1 != node.next)
+            nodes_[node.next].prev = node.prev;
+        node.prev = node.next = -1;
+        node.level = -1;
+    }
+};
+
+#endif
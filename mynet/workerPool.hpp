@@ -0,0 +1,119 @@
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <stop_token>
+#include <atomic>
+#include <chrono>
+
+#ifndef WORKERPOOL_HPP
+#define WORKERPOOL_HPP
+
+// 工作线程空闲时最长等待时间（ms）
+#define WORKER_IDLE_WAIT_TIME 10
+
+// 工作窃取线程池：每个工作线程一个任务双端队列，自己从队首取，空闲时从其他队列队尾偷
+class WorkerPool
+{
+    struct Worker
+    {
+        std::mutex mtx;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> nextWorker_;
+    std::atomic<int> pending_;
+    std::mutex sleepMtx_;
+    std::condition_variable cv_;
+    std::vector<std::jthread> threads_; // 须最后构造、最先析构
+
+public:
+    explicit WorkerPool(int threadNum)
+        : nextWorker_(0),
+          pending_(0)
+    {
+        if (threadNum < 1)
+            threadNum = 1;
+        workers_.reserve(threadNum);
+        for (int i = 0; i < threadNum; ++i)
+            workers_.emplace_back(std::make_unique<Worker>());
+        threads_.reserve(threadNum);
+        for (int i = 0; i < threadNum; ++i)
+            threads_.emplace_back(std::jthread([this, i](std::stop_token st)
+                                               { workerLoop(st, i); }));
+    }
+    ~WorkerPool()
+    {
+        for (auto &t : threads_)
+            t.request_stop();
+        cv_.notify_all();
+        for (auto &t : threads_)
+            if (t.joinable())
+                t.join();
+    }
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+    WorkerPool(WorkerPool &&) = delete;
+    WorkerPool &operator=(WorkerPool &&) = delete;
+    int size() const { return static_cast<int>(workers_.size()); }
+    // 轮流投递到各工作线程队列，任务之间不保证顺序
+    void submit_r(std::function<void()> task)
+    {
+        Worker &worker = *workers_[nextWorker_.fetch_add(1, std::memory_order_relaxed) % workers_.size()];
+        {
+            std::lock_guard<std::mutex> locker(worker.mtx);
+            worker.tasks.push_back(std::move(task));
+        }
+        pending_.fetch_add(1, std::memory_order_release);
+        cv_.notify_one();
+    }
+
+private:
+    void workerLoop(std::stop_token st, int index)
+    {
+        std::function<void()> task;
+        while (!st.stop_requested())
+        {
+            if (takeOwn(index, task) || steal(index, task))
+            {
+                pending_.fetch_sub(1, std::memory_order_relaxed);
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> locker(sleepMtx_);
+            cv_.wait_for(locker, std::chrono::milliseconds(WORKER_IDLE_WAIT_TIME), [&]
+                         { return pending_.load(std::memory_order_acquire) > 0 || st.stop_requested(); });
+        }
+    }
+    bool takeOwn(int index, std::function<void()> &task)
+    {
+        Worker &worker = *workers_[index];
+        std::lock_guard<std::mutex> locker(worker.mtx);
+        if (worker.tasks.empty())
+            return false;
+        task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        return true;
+    }
+    bool steal(int index, std::function<void()> &task)
+    {
+        for (size_t i = 1; i < workers_.size(); ++i)
+        {
+            Worker &victim = *workers_[(index + i) % workers_.size()];
+            std::unique_lock<std::mutex> locker(victim.mtx, std::try_to_lock);
+            if (!locker.owns_lock() || victim.tasks.empty())
+                continue;
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+        return false;
+    }
+};
+
+#endif
@@ -57,7 +57,9 @@ public:
     }
     ~Animator()
     {
+#ifndef BBG_HEADLESS
         glDeleteBuffers(1, &SSBO_);
+#endif
         curAnim_ = nullptr;
     }
     void swap(Animator &other)
@@ -101,7 +103,24 @@ public:
                   << ", duration: " << curAnim_->getDuration()
                   << ", ticks/s: " << curAnim_->getTicksPerSecond() << std::endl;
     }
+#ifndef BBG_HEADLESS
     void updateAnimation(Shader &shader, double deltaTime = 0.0)
+    {
+        updatePose(shader, deltaTime);
+        draw(shader);
+    }
+    // 所有实例共用同一姿态，整帧只推进一次动画；lodCounts见Model::drawInstanced
+    void updateAnimationInstanced(Shader &shader, std::span<const glm::mat4> globalMats, double deltaTime = 0.0,
+                                  std::span<const GLsizei> lodCounts = {})
+    {
+        updatePose(shader, deltaTime);
+        drawInstanced(shader, globalMats, lodCounts);
+    }
+#endif
+
+private:
+#ifndef BBG_HEADLESS
+    void updatePose(Shader &shader, double deltaTime)
     {
         assert(curAnim_ != nullptr);
         if (curTick_ < curAnim_->getDuration())
@@ -117,10 +136,8 @@ public:
             glBindBuffer(GL_SHADER_STORAGE_BUFFER, SSBO_);
             glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, finalTransforms_.size() * sizeof(glm::mat4), finalTransforms_.data());
         }
-        draw(shader);
     }
-
-private:
+#endif
     void readAnimations(const std::filesystem::path &path)
     {
         Assimp::Importer importer;
@@ -144,6 +161,7 @@ private:
             ///////////////////////////////////////////////////////////////
         }
         finalTransforms_.resize(getBonesLoaded().size(), glm::mat4(1.0f));
+#ifndef BBG_HEADLESS
         glGenBuffers(1, &SSBO_);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, SSBO_);
         glBufferData(GL_SHADER_STORAGE_BUFFER,
@@ -151,6 +169,7 @@ private:
                      finalTransforms_.data(),
                      GL_DYNAMIC_DRAW);
         bindingIndex_ = nextBindingPoint++;
+#endif
     }
     void calculateFinalTransform(const Hierarchy *node, glm::mat4 parentTransform)
     {
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <string.h>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#ifndef FRAME_UNIFORMS_HPP
+#define FRAME_UNIFORMS_HPP
+
+// Camera块的绑定点，须与glsl中layout(binding = ...)一致
+#define CAMERA_UBO_BINDING 0
+// 环形缓冲的帧数，CPU最多领先GPU (FRAME_UBO_RING - 1) 帧
+#define FRAME_UBO_RING 3
+
+// 与glsl中的Camera块逐字节对应（std140：mat4按4个vec4列排列，vec4对齐16字节）
+struct alignas(16) CameraBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 viewPos; // w未使用
+};
+static_assert(sizeof(CameraBlock) == 3 * 64 + 16, "CameraBlock must match the std140 layout");
+
+// 每帧一次写入相机矩阵的UBO：持久映射，FRAME_UBO_RING段轮流使用，每段用fence确认GPU读完后再覆盖
+class FrameUniforms
+{
+    GLuint UBO_;
+    GLsizeiptr stride_; // 按GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT对齐的段长
+    char *mapped_;
+    GLsync fences_[FRAME_UBO_RING];
+    unsigned int frame_;
+
+public:
+    FrameUniforms() : UBO_(0), stride_(0), mapped_(nullptr), fences_{}, frame_(0)
+    {
+        GLint align = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+        if (align <= 0)
+            align = 256;
+        stride_ = (sizeof(CameraBlock) + align - 1) / align * align;
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &UBO_);
+        glNamedBufferStorage(UBO_, stride_ * FRAME_UBO_RING, nullptr, flags);
+        mapped_ = static_cast<char *>(glMapNamedBufferRange(UBO_, 0, stride_ * FRAME_UBO_RING, flags));
+        if (nullptr == mapped_)
+            std::cerr << "Failed to map the frame uniform buffer" << std::endl;
+    }
+    ~FrameUniforms()
+    {
+        for (auto &fence : fences_)
+            if (nullptr != fence)
+                glDeleteSync(fence);
+        if (nullptr != mapped_)
+            glUnmapNamedBuffer(UBO_);
+        glDeleteBuffers(1, &UBO_);
+    }
+    FrameUniforms(const FrameUniforms &) = delete;
+    FrameUniforms &operator=(const FrameUniforms &) = delete;
+    FrameUniforms(FrameUniforms &&) = delete;
+    FrameUniforms &operator=(FrameUniforms &&) = delete;
+
+    // 帧开始、绘制之前调用：写入本帧的段并绑定到CAMERA_UBO_BINDING
+    void update(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &viewPos)
+    {
+        if (nullptr == mapped_)
+            return;
+        unsigned int slot = frame_ % FRAME_UBO_RING;
+        waitFence(fences_[slot]);
+        CameraBlock block{view, projection, projection * view, glm::vec4(viewPos, 1.0f)};
+        memcpy(mapped_ + slot * stride_, &block, sizeof(block)); // 一致性映射，无需flush
+        glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_UBO_BINDING, UBO_, slot * stride_, sizeof(CameraBlock));
+    }
+    // 本帧所有绘制提交之后调用
+    void endFrame()
+    {
+        if (nullptr == mapped_)
+            return;
+        unsigned int slot = frame_ % FRAME_UBO_RING;
+        if (nullptr != fences_[slot])
+            glDeleteSync(fences_[slot]);
+        fences_[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ++frame_;
+    }
+
+private:
+    static void waitFence(GLsync &fence)
+    {
+        if (nullptr == fence)
+            return;
+        // 正常情况下该段早已被GPU读完，这里几乎不会阻塞
+        for (;;)
+        {
+            GLenum rt = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1ms
+            if (GL_ALREADY_SIGNALED == rt || GL_CONDITION_SATISFIED == rt || GL_WAIT_FAILED == rt)
+                break;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+};
+
+#endif
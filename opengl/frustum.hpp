@@ -0,0 +1,179 @@
+#include <vector>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <glm/glm.hpp>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+// 局部空间的包围体，加载时由顶点计算
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+    glm::vec3 center = glm::vec3(0.0f); // 包围球球心（AABB中心）
+    float radius = -1.0f;               // 小于0表示空
+
+    bool empty() const { return radius < 0.0f; }
+    void expand(const glm::vec3 &p)
+    {
+        min = glm::vec3(fminf(min.x, p.x), fminf(min.y, p.y), fminf(min.z, p.z));
+        max = glm::vec3(fmaxf(max.x, p.x), fmaxf(max.y, p.y), fmaxf(max.z, p.z));
+    }
+    void expand(const Bounds &other)
+    {
+        if (other.empty())
+            return;
+        expand(other.min);
+        expand(other.max);
+    }
+    // expand之后调用；点集给出时用到各点的最大距离作半径，否则用AABB的外接球
+    template <class V>
+    void finish(const std::vector<V> &vertices)
+    {
+        if (min.x > max.x)
+            return;
+        center = (min + max) * 0.5f;
+        float r2 = 0.0f;
+        for (auto &v : vertices)
+        {
+            glm::vec3 d = v.position - center;
+            r2 = fmaxf(r2, glm::dot(d, d));
+        }
+        radius = sqrtf(r2);
+    }
+    void finish()
+    {
+        if (min.x > max.x)
+            return;
+        center = (min + max) * 0.5f;
+        glm::vec3 d = max - center;
+        radius = sqrtf(glm::dot(d, d));
+    }
+    // 变换到世界空间的包围球，半径按最大轴向缩放放大
+    void transformSphere(const glm::mat4 &m, glm::vec3 &worldCenter, float &worldRadius) const
+    {
+        if (empty())
+        {
+            worldCenter = center;
+            worldRadius = -FLT_MAX; // 总是不可见
+            return;
+        }
+        glm::vec4 c = m * glm::vec4(center, 1.0f);
+        worldCenter = glm::vec3(c.x, c.y, c.z);
+        float s = 0.0f;
+        for (int i = 0; i < 3; ++i)
+            s = fmaxf(s, m[i][0] * m[i][0] + m[i][1] * m[i][1] + m[i][2] * m[i][2]);
+        worldRadius = radius * sqrtf(s);
+    }
+};
+
+// 视锥的6个平面，法线朝内并已归一化：dot(n, p) + d >= 0 为内侧
+struct Frustum
+{
+    float planes[6][4];
+
+    // Gribb-Hartmann：由projection * view的行向量组合得到，裁剪空间z为[-w, w]
+    static Frustum fromMatrix(const glm::mat4 &viewProjection)
+    {
+        Frustum f;
+        const glm::mat4 &m = viewProjection; // m[列][行]
+        for (int i = 0; i < 3; ++i)
+            for (int side = 0; side < 2; ++side)
+            {
+                float sign = 0 == side ? 1.0f : -1.0f;
+                float *p = f.planes[2 * i + side];
+                for (int c = 0; c < 4; ++c)
+                    p[c] = m[c][3] + sign * m[c][i];
+                float len = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+                if (len > 0.0f)
+                    for (int c = 0; c < 4; ++c)
+                        p[c] /= len;
+            }
+        return f;
+    }
+    bool sphereVisible(const glm::vec3 &c, float r) const
+    {
+        for (auto &p : planes)
+            if (p[0] * c.x + p[1] * c.y + p[2] * c.z + p[3] < -r)
+                return false;
+        return true;
+    }
+};
+
+// 世界空间包围球的SoA数组，一次测试4个球对6个平面
+class SphereCuller
+{
+    std::vector<float> x_, y_, z_, r_; // 长度补齐到4的倍数，补齐部分半径为-FLT_MAX，总是不可见
+    size_t size_ = 0;
+
+public:
+    void resize(size_t n)
+    {
+        size_ = n;
+        size_t padded = (n + 3) & ~static_cast<size_t>(3);
+        x_.assign(padded, 0.0f);
+        y_.assign(padded, 0.0f);
+        z_.assign(padded, 0.0f);
+        r_.assign(padded, -FLT_MAX);
+    }
+    size_t size() const { return size_; }
+    void set(size_t i, const glm::vec3 &c, float r)
+    {
+        x_[i] = c.x;
+        y_[i] = c.y;
+        z_[i] = c.z;
+        r_[i] = r;
+    }
+    // visible[i]为1表示与视锥相交，返回可见数
+    size_t cull(const Frustum &frustum, std::vector<uint8_t> &visible) const
+    {
+        visible.resize(x_.size());
+        size_t count = 0;
+#if defined(__SSE2__)
+        __m128 px[6], py[6], pz[6], pw[6];
+        for (int p = 0; p < 6; ++p)
+        {
+            px[p] = _mm_set1_ps(frustum.planes[p][0]);
+            py[p] = _mm_set1_ps(frustum.planes[p][1]);
+            pz[p] = _mm_set1_ps(frustum.planes[p][2]);
+            pw[p] = _mm_set1_ps(frustum.planes[p][3]);
+        }
+        for (size_t i = 0; i < x_.size(); i += 4)
+        {
+            __m128 x = _mm_loadu_ps(&x_[i]);
+            __m128 y = _mm_loadu_ps(&y_[i]);
+            __m128 z = _mm_loadu_ps(&z_[i]);
+            __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&r_[i]));
+            __m128 outside = _mm_setzero_ps();
+            for (int p = 0; p < 6; ++p)
+            {
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+                                      _mm_add_ps(_mm_mul_ps(pz[p], z), pw[p]));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negR));
+            }
+            int mask = _mm_movemask_ps(outside);
+            for (int k = 0; k < 4; ++k)
+            {
+                visible[i + k] = !((mask >> k) & 1);
+                count += visible[i + k];
+            }
+        }
+#else
+        for (size_t i = 0; i < x_.size(); ++i)
+        {
+            visible[i] = frustum.sphereVisible(glm::vec3(x_[i], y_[i], z_[i]), r_[i]);
+            count += visible[i];
+        }
+#endif
+        visible.resize(size_);
+        return count;
+    }
+};
+
+#endif
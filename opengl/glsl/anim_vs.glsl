@@ -1,31 +1,48 @@
 #version 460 core
 const int MAX_BONE_INFLUENCE = 4;
 
+// vertex layout: SkinnedVertex in vertexFormat.hpp
 layout(location = 0) in vec3 pos;
-layout(location = 1) in vec3 norm;
+layout(location = 1) in vec2 normOct;
 layout(location = 2) in vec2 tex;
-layout(location = 3) in vec3 tangent;
-layout(location = 4) in vec3 bitangent;
-layout(location = 5) in ivec4 boneIds;
+layout(location = 3) in vec4 tangentOct; // xy octahedral tangent, z bitangent sign
+layout(location = 5) in uvec4 boneIds; // 0xFFFF: no bone
 layout(location = 6) in vec4 weights;
 
 layout(std430) buffer BoneTrans { mat4 finalTransforms[]; };
 
-uniform mat4 projection;
-uniform mat4 view;
+// written once per frame, see CameraBlock and CAMERA_UBO_BINDING in frameUniforms.hpp
+layout(std140, binding = 0) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+};
+
 uniform mat4 model;
 
 out vec2 texCoords;
 out vec3 normal;
 
+// inverse of VertexPacking::octEncode in vertexFormat.hpp
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+    return normalize(v);
+}
+
 void main() 
 {
     vec4 finalPos = vec4(0.0);
     vec3 finalNorm = vec3(0.0);
+    vec3 norm = octDecode(normOct);
     
     for(int i = 0; i < MAX_BONE_INFLUENCE; ++i) 
     {
-        if(-1 == boneIds[i])continue;
+        if(0xFFFFu == boneIds[i])continue;
         mat4 finalTrans = finalTransforms[boneIds[i]];
         finalPos += finalTrans * vec4(pos, 1.0) * weights[i];
         finalNorm += mat3(finalTrans) * norm * weights[i];
@@ -36,7 +53,7 @@ void main()
     else
         finalNorm = vec3(0.0, 0.0, 1.0);
 
-    gl_Position = projection * view * model * finalPos;
+    gl_Position = viewProjection * model * finalPos;
     normal = finalNorm;
     texCoords = tex;
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+#version 460 core
+// GPU visibility for IndirectRenderer::drawGpuCulled in indirectRenderer.hpp:
+// one invocation per draw command, frustum test against the current camera,
+// occlusion test against the previous frame's depth pyramid (HiZBuffer),
+// LOD selection by projected error with hysteresis (same rule as LodSelector in lod.hpp),
+// survivors are appended to their batch's range of the output command buffer
+layout(local_size_x = 64) in;
+
+// same layout as GpuCullRecord
+struct CullRecord
+{
+    vec4 sphere; // object space center and radius, radius < 0 for empty meshes
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance; // object slot, indexes objectMats
+    uint batch;
+    uint outFirst; // first command of the batch in CulledCommands
+    uint lodNum;
+    vec4 lodError; // object space error of each level, non-decreasing
+    uvec2 lodRange[4]; // firstIndex, count
+};
+
+// same layout as DrawElementsIndirectCommand
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430) readonly buffer CullRecords { CullRecord records[]; };
+layout(std430) readonly buffer ObjectMatrices { mat4 objectMats[]; };
+layout(std430) writeonly buffer CulledCommands { DrawCommand commands[]; };
+layout(std430) buffer DrawCounts { uint drawCounts[]; }; // one per batch, cleared before dispatch
+layout(std430) buffer LodStates { uint lodStates[]; }; // level chosen last frame, one per record
+
+// written once per frame, see CameraBlock and CAMERA_UBO_BINDING in frameUniforms.hpp
+layout(std140, binding = 0) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+};
+
+uniform uint recordNum;
+uniform bool occlusion; // false until the first pyramid exists
+uniform mat4 prevViewProjection; // camera the pyramid was rendered with
+uniform sampler2D hiZ;
+uniform vec2 hiZSize; // level 0 size in texels
+uniform int hiZLevels;
+uniform float viewportHeight;
+uniform float lodPixelError;
+uniform float lodHysteresis;
+
+// Gribb-Hartmann planes of the current camera, same as Frustum::fromMatrix
+bool frustumVisible(vec3 c, float r)
+{
+    mat4 rows = transpose(viewProjection);
+    for (int i = 0; i < 3; ++i)
+        for (int s = 0; s < 2; ++s)
+        {
+            vec4 p = rows[3] + (s == 0 ? rows[i] : -rows[i]);
+            if (dot(p.xyz, c) + p.w < -r * length(p.xyz))
+                return false;
+        }
+    return true;
+}
+
+// conservative: anything crossing the near plane or the edge of the previous view is kept
+bool occluded(vec3 c, float r)
+{
+    vec2 uvMin = vec2(1.0);
+    vec2 uvMax = vec2(0.0);
+    float zMin = 1.0;
+    for (int i = 0; i < 8; ++i)
+    {
+        vec3 corner = c + r * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = prevViewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        uvMin = min(uvMin, ndc.xy * 0.5 + 0.5);
+        uvMax = max(uvMax, ndc.xy * 0.5 + 0.5);
+        zMin = min(zMin, ndc.z * 0.5 + 0.5);
+    }
+    if (any(lessThan(uvMin, vec2(0.0))) || any(greaterThan(uvMax, vec2(1.0))) || zMin <= 0.0)
+        return false;
+    // the level where the rectangle spans at most 2x2 texels
+    vec2 extent = (uvMax - uvMin) * hiZSize;
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, hiZLevels - 1);
+    ivec2 size = max(ivec2(hiZSize) >> level, ivec2(1));
+    ivec2 lo = min(ivec2(uvMin * vec2(size)), size - 1);
+    ivec2 hi = min(ivec2(uvMax * vec2(size)), size - 1);
+    float depth = max(max(texelFetch(hiZ, lo, level).r, texelFetch(hiZ, ivec2(hi.x, lo.y), level).r),
+                      max(texelFetch(hiZ, ivec2(lo.x, hi.y), level).r, texelFetch(hiZ, hi, level).r));
+    return zMin > depth;
+}
+
+// coarsest level whose projected error stays within the given number of pixels
+uint coarsest(CullRecord rec, float pixelsPerUnit, float pixels)
+{
+    uint level = 0u;
+    while (level + 1u < rec.lodNum && rec.lodError[level + 1u] * pixelsPerUnit <= pixels)
+        ++level;
+    return level;
+}
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= recordNum)
+        return;
+    CullRecord rec = records[i];
+    if (rec.sphere.w < 0.0)
+        return;
+    // world sphere, radius scaled by the largest axis, same as Bounds::transformSphere
+    mat4 m = objectMats[rec.baseInstance];
+    vec3 c = (m * vec4(rec.sphere.xyz, 1.0)).xyz;
+    float s = max(dot(m[0].xyz, m[0].xyz), max(dot(m[1].xyz, m[1].xyz), dot(m[2].xyz, m[2].xyz)));
+    float r = rec.sphere.w * sqrt(s);
+    if (!frustumVisible(c, r))
+        return;
+    if (occlusion && occluded(c, r))
+        return;
+    float pixelsPerUnit = 0.5 * projection[1][1] * viewportHeight * sqrt(s) / max(distance(c, viewPos.xyz) - r, 1e-3);
+    uint lod = min(lodStates[i], max(rec.lodNum, 1u) - 1u);
+    uint finer = coarsest(rec, pixelsPerUnit, lodPixelError * (1.0 + lodHysteresis));
+    lod = lod > finer ? finer : max(lod, coarsest(rec, pixelsPerUnit, lodPixelError * (1.0 - lodHysteresis)));
+    lodStates[i] = lod;
+    uvec2 range = rec.lodNum > 0u ? rec.lodRange[lod] : uvec2(rec.firstIndex, rec.count);
+    uint slot = atomicAdd(drawCounts[rec.batch], 1u);
+    commands[rec.outFirst + slot] = DrawCommand(range.y, 1u, range.x, rec.baseVertex, rec.baseInstance);
+}
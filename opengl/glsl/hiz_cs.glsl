@@ -0,0 +1,28 @@
+#version 460 core
+// one level of the hierarchical depth pyramid, see HiZBuffer in hiZBuffer.hpp
+// each destination texel stores the farthest depth of every source texel it overlaps,
+// so a texel never claims to occlude more than the source did
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D src; // depth copy for level 0, the pyramid itself for the others
+uniform int srcLevel;
+uniform ivec2 srcSize;
+uniform ivec2 dstSize;
+
+layout(r32f, binding = 0) uniform writeonly image2D dst;
+
+void main()
+{
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(p, dstSize)))
+        return;
+    // source range covered by this texel in normalized coordinates, rounded outwards
+    ivec2 lo = (p * srcSize) / dstSize;
+    ivec2 hi = min(((p + 1) * srcSize + dstSize - 1) / dstSize, srcSize);
+    hi = max(hi, lo + 1);
+    float depth = 0.0;
+    for (int y = lo.y; y < hi.y; ++y)
+        for (int x = lo.x; x < hi.x; ++x)
+            depth = max(depth, texelFetch(src, min(ivec2(x, y), srcSize - 1), srcLevel).r);
+    imageStore(dst, p, vec4(depth));
+}
@@ -1,26 +1,40 @@
 #version 460 core
 const int MAX_BONE_INFLUENCE = 4;
 
+// vertex layout: StaticVertex in vertexFormat.hpp
 layout(location = 0) in vec3 pos;
-layout(location = 1) in vec3 norm;
+layout(location = 1) in vec2 normOct;
 layout(location = 2) in vec2 tex;
-layout(location = 3) in vec3 tangent;
-layout(location = 4) in vec3 bitangent;
-layout(location = 5) in ivec4 boneIds;
-layout(location = 6) in vec4 weights;
+layout(location = 3) in vec4 tangentOct; // xy octahedral tangent, z bitangent sign
+
+// written once per frame, see CameraBlock and CAMERA_UBO_BINDING in frameUniforms.hpp
+layout(std140, binding = 0) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+};
 
-uniform mat4 projection;
-uniform mat4 view;
 uniform mat4 model;
 
 out vec2 texCoords;
 out vec3 normal;
 
+// inverse of VertexPacking::octEncode in vertexFormat.hpp
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+    return normalize(v);
+}
+
 void main() 
 {
-    gl_Position = projection * view * model * vec4(pos, 1.0);
+    gl_Position = viewProjection * model * vec4(pos, 1.0);
 
     mat3 normalMatrix = transpose(inverse(mat3(model)));
-    normal = normalize(normalMatrix * norm);
+    normal = normalize(normalMatrix * octDecode(normOct));
     texCoords = tex;
 }
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <algorithm>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "renderState.hpp"
+
+#ifndef HIZ_BUFFER_HPP
+#define HIZ_BUFFER_HPP
+
+// hiz_cs.glsl的工作组边长，须与glsl中local_size一致
+#define HIZ_GROUP_SIZE 8
+
+// 上一帧深度的层级最大值金字塔（R32F，每个texel为其覆盖区域中最远的深度），供cull_cs.glsl做遮挡剔除
+// 第0层为不小于半屏分辨率的2的幂，之后每层严格2x2归约，纹理坐标到texel的映射在各层都保守
+class HiZBuffer
+{
+    GLuint depth_;   // 默认帧缓冲深度的拷贝
+    GLuint pyramid_; // R32F，完整mip链
+    GLint viewport_[4];
+    GLsizei width_, height_; // 金字塔第0层的尺寸
+    GLint levels_;
+    glm::mat4 viewProjection_; // 生成金字塔时的相机矩阵
+    bool valid_;
+
+public:
+    HiZBuffer() : depth_(0), pyramid_(0), viewport_{}, width_(0), height_(0), levels_(0), viewProjection_(1.0f), valid_(false) {}
+    ~HiZBuffer()
+    {
+        GLStateCache::getInstance().deleteTexture(depth_);
+        GLStateCache::getInstance().deleteTexture(pyramid_);
+    }
+    HiZBuffer(const HiZBuffer &) = delete;
+    HiZBuffer &operator=(const HiZBuffer &) = delete;
+    HiZBuffer(HiZBuffer &&) = delete;
+    HiZBuffer &operator=(HiZBuffer &&) = delete;
+
+    // 本帧所有不透明物体绘制之后、交换缓冲之前调用，reduceShader为hiz_cs.glsl
+    // 视口尺寸变化时重新分配纹理
+    void update(Shader &reduceShader, const glm::mat4 &viewProjection)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        if (viewport[2] <= 0 || viewport[3] <= 0)
+        {
+            valid_ = false;
+            return;
+        }
+        if (viewport[2] != viewport_[2] || viewport[3] != viewport_[3] || 0 == depth_)
+            allocate(viewport[2], viewport[3]);
+        std::copy(viewport, viewport + 4, viewport_);
+        glCopyTextureSubImage2D(depth_, 0, 0, 0, viewport_[0], viewport_[1], viewport_[2], viewport_[3]);
+        reduceShader.use();
+        const GLint srcLevel = reduceShader.location("srcLevel");
+        const GLint srcSize = reduceShader.location("srcSize");
+        const GLint dstSize = reduceShader.location("dstSize");
+        glUniform1i(reduceShader.location("src"), 0);
+        GLsizei srcW = viewport_[2], srcH = viewport_[3];
+        GLsizei dstW = width_, dstH = height_;
+        for (GLint level = 0; level < levels_; ++level)
+        {
+            GLStateCache::getInstance().bindTexture(0, 0 == level ? depth_ : pyramid_);
+            glUniform1i(srcLevel, 0 == level ? 0 : level - 1);
+            glUniform2i(srcSize, srcW, srcH);
+            glUniform2i(dstSize, dstW, dstH);
+            glBindImageTexture(0, pyramid_, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            glDispatchCompute((dstW + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (dstH + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            srcW = dstW;
+            srcH = dstH;
+            dstW = std::max(1, dstW / 2);
+            dstH = std::max(1, dstH / 2);
+        }
+        glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        GLStateCache::getInstance().bindTexture(0, 0);
+        viewProjection_ = viewProjection;
+        valid_ = true;
+    }
+    void bind(GLuint unit) const { GLStateCache::getInstance().bindTexture(unit, pyramid_); }
+    // 还没有生成过金字塔时为false，此时只做视锥剔除
+    bool valid() const { return valid_; }
+    const glm::mat4 &getViewProjection() const { return viewProjection_; }
+    glm::vec2 getSize() const { return glm::vec2(static_cast<float>(width_), static_cast<float>(height_)); }
+    GLint getLevels() const { return levels_; }
+
+private:
+    static GLsizei floorPow2(GLsizei v)
+    {
+        GLsizei p = 1;
+        while (p * 2 <= v)
+            p *= 2;
+        return p;
+    }
+    void allocate(GLsizei width, GLsizei height)
+    {
+        GLStateCache::getInstance().deleteTexture(depth_);
+        GLStateCache::getInstance().deleteTexture(pyramid_);
+        glCreateTextures(GL_TEXTURE_2D, 1, &depth_);
+        glTextureStorage2D(depth_, 1, GL_DEPTH_COMPONENT32F, width, height);
+        glTextureParameteri(depth_, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(depth_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        // 每个第0层texel对应不超过3x3个屏幕像素，hiz_cs.glsl按覆盖范围取最大值
+        width_ = std::max(1, floorPow2(width - 1));
+        height_ = std::max(1, floorPow2(height - 1));
+        levels_ = 1;
+        while ((std::max(width_, height_) >> levels_) > 0)
+            ++levels_;
+        glCreateTextures(GL_TEXTURE_2D, 1, &pyramid_);
+        glTextureStorage2D(pyramid_, levels_, GL_R32F, width_, height_);
+        glTextureParameteri(pyramid_, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTextureParameteri(pyramid_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(pyramid_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(pyramid_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        valid_ = false;
+        std::clog << "Hi-Z pyramid: " << width_ << "x" << height_ << ", " << levels_ << " levels" << std::endl;
+    }
+};
+
+#endif
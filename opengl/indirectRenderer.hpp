@@ -0,0 +1,340 @@
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "frustum.hpp"
+#include "hiZBuffer.hpp"
+#include "lod.hpp"
+#include "renderState.hpp"
+
+#ifndef INDIRECT_RENDERER_HPP
+#define INDIRECT_RENDERER_HPP
+
+// 与glMultiDrawElementsIndirect要求的布局一致
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance; // 对象槽位，顶点着色器经INSTANCE_MATRIX_LOCATION取到该对象的模型矩阵
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must be tightly packed");
+
+// cull_cs.glsl的工作组大小，须与glsl中local_size_x一致
+#define GPU_CULL_GROUP_SIZE 64
+// GPU剔除占用的SSBO绑定点个数，取最大绑定点往下的这几个，避开Animator从0开始分配的绑定点
+#define GPU_CULL_SSBO_NUM 5
+
+// 与cull_cs.glsl中的CullRecord逐字节对应（std430）
+struct GpuCullRecord
+{
+    glm::vec4 sphere; // 局部空间包围球，w为半径，小于0表示空mesh
+    DrawElementsIndirectCommand command;
+    GLuint batch;
+    GLuint outFirst; // 该批在输出命令缓冲中的起始下标
+    GLuint lodNum;
+    float lodError[LOD_MAX_LEVELS];
+    GLuint lodRange[LOD_MAX_LEVELS][2]; // firstIndex、count
+};
+static_assert(LOD_MAX_LEVELS == 4, "cull_cs.glsl stores LOD errors in a vec4");
+static_assert(sizeof(GpuCullRecord) == 96, "GpuCullRecord must match the std430 layout");
+
+// 静态模型的合批渲染：所有mesh的顶点与索引拷贝进共享的arena，同一顶点格式共用一个VAO
+// 纹理相同的mesh归为一批，每批一次glMultiDrawElementsIndirect，绘制开销只随材质数增长
+// 用法：add若干模型 -> build -> 每帧按需setTransform -> draw或drawGpuCulled
+// 静态绘制不需要骨骼数据，统一打包为StaticVertex，对应一个VAO
+class IndirectRenderer
+{
+    struct Batch
+    {
+        std::vector<Texture> textures;
+        std::vector<uint64_t> samplerHashes;
+        std::vector<DrawElementsIndirectCommand> commands; // build之前暂存
+        std::vector<Bounds> bounds;                        // 与commands一一对应，build之前暂存
+        std::vector<std::vector<LodLevel>> lods;           // 同上，firstIndex已是arena中的下标
+        size_t first = 0;                                  // build之后在命令缓冲中的起始下标
+        GLsizei count = 0;
+    };
+
+    std::vector<StaticVertex> vertices_; // build之后释放
+    std::vector<GLuint> indices_;
+    std::vector<glm::mat4> globalMats_; // 下标即对象槽位
+    std::vector<Batch> batches_;
+    std::vector<DrawElementsIndirectCommand> commands_; // 命令缓冲的CPU副本
+    std::vector<Bounds> commandBounds_;                 // 每条命令（mesh）的局部包围体
+    std::vector<std::vector<LodLevel>> commandLods_;    // 每条命令的LOD链，上传GPU剔除的输入后释放
+    GLuint VAO_, VBO_, EBO_, matrixVBO_, commandBuffer_;
+    GLuint cullRecordBuffer_, culledCommandBuffer_, drawCountBuffer_; // GPU剔除的输入、压缩后的命令、每批的命令数
+    GLuint lodStateBuffer_;                                           // 每条命令上一帧的LOD级别
+    GLuint ssboBase_;
+    bool built_;
+    bool matricesDirty_;
+
+public:
+    IndirectRenderer()
+        : VAO_(0), VBO_(0), EBO_(0), matrixVBO_(0), commandBuffer_(0),
+          cullRecordBuffer_(0), culledCommandBuffer_(0), drawCountBuffer_(0), lodStateBuffer_(0), ssboBase_(0), built_(false), matricesDirty_(false) {}
+    ~IndirectRenderer()
+    {
+        GLStateCache::getInstance().deleteVertexArray(VAO_);
+        glDeleteBuffers(1, &VBO_);
+        glDeleteBuffers(1, &EBO_);
+        glDeleteBuffers(1, &matrixVBO_);
+        glDeleteBuffers(1, &commandBuffer_);
+        glDeleteBuffers(1, &cullRecordBuffer_);
+        glDeleteBuffers(1, &culledCommandBuffer_);
+        glDeleteBuffers(1, &drawCountBuffer_);
+        glDeleteBuffers(1, &lodStateBuffer_);
+    }
+    IndirectRenderer(const IndirectRenderer &) = delete;
+    IndirectRenderer &operator=(const IndirectRenderer &) = delete;
+    IndirectRenderer(IndirectRenderer &&) = delete;
+    IndirectRenderer &operator=(IndirectRenderer &&) = delete;
+
+    // 拷贝模型所有mesh的几何数据，之后模型本身可以释放
+    // rt:
+    //   >=0 对象槽位，用于setTransform
+    //   -1  已经build
+    int add(Model &model, const glm::mat4 &globalMat = glm::mat4(1.0f))
+    {
+        if (built_)
+            return -1;
+        GLuint object = static_cast<GLuint>(globalMats_.size());
+        globalMats_.push_back(globalMat);
+        for (auto &mesh : model.getMeshes())
+        {
+            auto &vertices = mesh.getVertices();
+            auto &indices = mesh.getIndices();
+            if (indices.empty())
+                continue;
+            DrawElementsIndirectCommand cmd{static_cast<GLuint>(indices.size()), 1,
+                                            static_cast<GLuint>(indices_.size()),
+                                            static_cast<GLint>(vertices_.size()), object};
+            std::vector<LodLevel> lods = mesh.getLods();
+            for (auto &level : lods)
+                level.firstIndex += static_cast<uint32_t>(indices_.size());
+            for (auto &vertex : vertices)
+                vertices_.push_back(StaticVertex::pack(vertex));
+            indices_.insert(indices_.end(), indices.begin(), indices.end());
+            indices_.insert(indices_.end(), mesh.getLodIndices().begin(), mesh.getLodIndices().end());
+            Batch &batch = batchOf(mesh.getTextures());
+            batch.commands.push_back(cmd);
+            batch.bounds.push_back(mesh.getBounds());
+            batch.lods.push_back(std::move(lods));
+        }
+        return static_cast<int>(object);
+    }
+    // 上传arena与命令缓冲，之后不能再add
+    void build()
+    {
+        if (built_)
+            return;
+        built_ = true;
+        for (auto &batch : batches_)
+        {
+            batch.first = commands_.size();
+            batch.count = static_cast<GLsizei>(batch.commands.size());
+            commands_.insert(commands_.end(), batch.commands.begin(), batch.commands.end());
+            commandBounds_.insert(commandBounds_.end(), batch.bounds.begin(), batch.bounds.end());
+            for (auto &lods : batch.lods)
+                commandLods_.push_back(std::move(lods));
+            std::vector<DrawElementsIndirectCommand>().swap(batch.commands);
+            std::vector<Bounds>().swap(batch.bounds);
+            std::vector<std::vector<LodLevel>>().swap(batch.lods);
+        }
+        if (commands_.empty())
+            return;
+        glCreateBuffers(1, &VBO_);
+        glNamedBufferStorage(VBO_, vertices_.size() * sizeof(StaticVertex), vertices_.data(), 0);
+        glCreateBuffers(1, &EBO_);
+        glNamedBufferStorage(EBO_, indices_.size() * sizeof(GLuint), indices_.data(), 0);
+        glCreateBuffers(1, &matrixVBO_);
+        glNamedBufferStorage(matrixVBO_, globalMats_.size() * sizeof(glm::mat4), globalMats_.data(), GL_DYNAMIC_STORAGE_BIT);
+        glCreateBuffers(1, &commandBuffer_);
+        glNamedBufferStorage(commandBuffer_, commands_.size() * sizeof(DrawElementsIndirectCommand), commands_.data(), GL_DYNAMIC_STORAGE_BIT);
+        buildGpuCulling();
+        glGenVertexArrays(1, &VAO_);
+        GLStateCache::getInstance().bindVertexArray(VAO_);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+        StaticVertex::setupAttributes();
+        glBindBuffer(GL_ARRAY_BUFFER, matrixVBO_);
+        setupInstanceAttributes();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+        GLStateCache::getInstance().bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        std::vector<StaticVertex>().swap(vertices_);
+        std::vector<GLuint>().swap(indices_);
+    }
+    // 修改后在下一次draw时整体上传
+    void setTransform(int object, const glm::mat4 &globalMat)
+    {
+        if (object < 0 || static_cast<size_t>(object) >= globalMats_.size())
+            return;
+        globalMats_[object] = globalMat;
+        matricesDirty_ = true;
+    }
+    // 可见性完全在GPU上判定：cullShader（cull_cs.glsl）按当前相机做视锥剔除，按hiZ（上一帧的深度金字塔）做遮挡剔除，
+    // 按屏幕空间误差选LOD级别（每条命令的级别留在GPU上，供下一帧做滞回），
+    // 把可见命令压缩到每批的输出区间，再用glMultiDrawElementsIndirectCount绘制，CPU不读回任何结果
+    // 会切换程序，结束时shader处于使用状态
+    void drawGpuCulled(Shader &shader, Shader &cullShader, const HiZBuffer &hiZ)
+    {
+        if (0 == VAO_)
+            return;
+        uploadMatrices();
+        cullShader.use();
+        bindStorageBlock(cullShader, "CullRecords", 0, cullRecordBuffer_);
+        bindStorageBlock(cullShader, "ObjectMatrices", 1, matrixVBO_);
+        bindStorageBlock(cullShader, "CulledCommands", 2, culledCommandBuffer_);
+        bindStorageBlock(cullShader, "DrawCounts", 3, drawCountBuffer_);
+        bindStorageBlock(cullShader, "LodStates", 4, lodStateBuffer_);
+        glClearNamedBufferData(drawCountBuffer_, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        const GLuint recordNum = static_cast<GLuint>(commands_.size());
+        glUniform1ui(cullShader.location("recordNum"), recordNum);
+        cullShader.setBool("occlusion", hiZ.valid());
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        cullShader.setFloat("viewportHeight", static_cast<float>(viewport[3]));
+        cullShader.setFloat("lodPixelError", LOD_PIXEL_ERROR);
+        cullShader.setFloat("lodHysteresis", LOD_HYSTERESIS);
+        if (hiZ.valid())
+        {
+            hiZ.bind(0);
+            cullShader.setInt("hiZ", 0);
+            cullShader.setMat4("prevViewProjection", hiZ.getViewProjection());
+            cullShader.setVec2("hiZSize", hiZ.getSize());
+            cullShader.setInt("hiZLevels", hiZ.getLevels());
+        }
+        glDispatchCompute((recordNum + GPU_CULL_GROUP_SIZE - 1) / GPU_CULL_GROUP_SIZE, 1, 1);
+        // 间接命令与计数缓冲都经由命令读取；下一帧glClearNamedBufferData清零计数缓冲前须等本帧的atomicAdd写完；
+        // LodStates本帧写入、下一帧的剔除读取
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        shader.use();
+        GLStateCache::getInstance().bindVertexArray(VAO_);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culledCommandBuffer_);
+        glBindBuffer(GL_PARAMETER_BUFFER, drawCountBuffer_);
+        for (size_t b = 0; b < batches_.size(); ++b)
+        {
+            auto &batch = batches_[b];
+            if (0 == batch.count)
+                continue;
+            bindTextures(shader, batch);
+            glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                             (void *)(batch.first * sizeof(DrawElementsIndirectCommand)),
+                                             static_cast<GLintptr>(b * sizeof(GLuint)), batch.count, 0);
+        }
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    // 不剔除；shader须从INSTANCE_MATRIX_LOCATION读取模型矩阵（如modl_inst_vs.glsl），调用前须use
+    void draw(Shader &shader)
+    {
+        if (0 == VAO_)
+            return;
+        uploadMatrices();
+        GLStateCache::getInstance().bindVertexArray(VAO_);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer_);
+        for (auto &batch : batches_)
+        {
+            if (0 == batch.count)
+                continue;
+            bindTextures(shader, batch);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        (void *)(batch.first * sizeof(DrawElementsIndirectCommand)), batch.count, 0);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    size_t getObjectNum() const { return globalMats_.size(); }
+    size_t getBatchNum() const { return batches_.size(); }
+
+private:
+    void uploadMatrices()
+    {
+        if (!matricesDirty_)
+            return;
+        glNamedBufferSubData(matrixVBO_, 0, globalMats_.size() * sizeof(glm::mat4), globalMats_.data());
+        matricesDirty_ = false;
+    }
+    static void bindTextures(Shader &shader, const Batch &batch)
+    {
+        for (unsigned int i = 0; i < batch.textures.size(); ++i)
+        {
+            glUniform1i(shader.location(batch.samplerHashes[i]), i);
+            GLStateCache::getInstance().bindTexture(i, batch.textures[i].id);
+        }
+    }
+    // build时调用，命令与包围体在之后不再变化，上传一次
+    void buildGpuCulling()
+    {
+        std::vector<GpuCullRecord> records;
+        records.reserve(commands_.size());
+        for (size_t b = 0; b < batches_.size(); ++b)
+            for (size_t i = batches_[b].first; i < batches_[b].first + batches_[b].count; ++i)
+            {
+                const Bounds &bounds = commandBounds_[i];
+                GpuCullRecord record{glm::vec4(bounds.center, bounds.empty() ? -1.0f : bounds.radius), commands_[i],
+                                     static_cast<GLuint>(b), static_cast<GLuint>(batches_[b].first), 0, {}, {}};
+                for (auto &level : commandLods_[i])
+                {
+                    if (record.lodNum == LOD_MAX_LEVELS)
+                        break;
+                    record.lodError[record.lodNum] = level.error;
+                    record.lodRange[record.lodNum][0] = level.firstIndex;
+                    record.lodRange[record.lodNum][1] = level.indexNum;
+                    ++record.lodNum;
+                }
+                records.push_back(record);
+            }
+        std::vector<std::vector<LodLevel>>().swap(commandLods_);
+        glCreateBuffers(1, &cullRecordBuffer_);
+        glNamedBufferStorage(cullRecordBuffer_, records.size() * sizeof(GpuCullRecord), records.data(), 0);
+        glCreateBuffers(1, &culledCommandBuffer_);
+        glNamedBufferStorage(culledCommandBuffer_, commands_.size() * sizeof(DrawElementsIndirectCommand), nullptr, 0);
+        glCreateBuffers(1, &drawCountBuffer_);
+        glNamedBufferStorage(drawCountBuffer_, batches_.size() * sizeof(GLuint), nullptr, 0);
+        std::vector<GLuint> lodStates(records.size(), 0);
+        glCreateBuffers(1, &lodStateBuffer_);
+        glNamedBufferStorage(lodStateBuffer_, lodStates.size() * sizeof(GLuint), lodStates.data(), 0);
+        GLint maxBindings = 0;
+        glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &maxBindings);
+        ssboBase_ = maxBindings > GPU_CULL_SSBO_NUM ? static_cast<GLuint>(maxBindings - GPU_CULL_SSBO_NUM) : 0;
+    }
+    // 同Animator：按块名把程序中的存储块指到绑定点
+    void bindStorageBlock(Shader &shader, const char *block, GLuint slot, GLuint buffer) const
+    {
+        GLuint blockIndex = glGetProgramResourceIndex(shader.getID(), GL_SHADER_STORAGE_BLOCK, block);
+        if (GL_INVALID_INDEX == blockIndex)
+        {
+            std::cerr << "Shader storage block " << block << " not found" << std::endl;
+            return;
+        }
+        glShaderStorageBlockBinding(shader.getID(), blockIndex, ssboBase_ + slot);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ssboBase_ + slot, buffer);
+    }
+    // 纹理id序列相同即视为同一材质
+    Batch &batchOf(const std::vector<Texture> &textures)
+    {
+        for (auto &batch : batches_)
+        {
+            if (batch.textures.size() != textures.size())
+                continue;
+            bool same = true;
+            for (size_t i = 0; i < textures.size() && same; ++i)
+                same = batch.textures[i].id == textures[i].id && batch.textures[i].type == textures[i].type;
+            if (same)
+                return batch;
+        }
+        Batch &batch = batches_.emplace_back();
+        batch.textures = textures;
+        for (auto &texture : textures)
+            batch.samplerHashes.push_back(uniformHash(texture.type));
+        return batch;
+    }
+};
+
+#endif
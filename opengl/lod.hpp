@@ -0,0 +1,477 @@
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "vertexCache.hpp"
+
+#ifndef LOD_HPP
+#define LOD_HPP
+
+// 每个mesh最多的级别数（含原始网格）
+#define LOD_MAX_LEVELS 4
+// 相邻级别的目标三角形数之比
+#define LOD_LEVEL_RATIO 0.5f
+// 新级别的三角形数须不超过上一级的这个比例，否则不再生成更粗的级别
+#define LOD_MIN_REDUCTION 0.8f
+// 简化允许的最大误差，相对包围盒对角线
+#define LOD_MAX_RELATIVE_ERROR 0.05f
+// 投影误差不超过这么多像素的级别才可以使用
+#define LOD_PIXEL_ERROR 1.0f
+// 阈值两侧的滞回比例，避免在阈值附近来回切换
+#define LOD_HYSTERESIS 0.25f
+
+// 一个级别在mesh索引缓冲中的区间，error为局部空间的几何误差（距离）
+struct LodLevel
+{
+    uint32_t firstIndex;
+    uint32_t indexNum;
+    float error;
+};
+
+// 加载时的二次误差度量（QEM）网格简化，半边折叠：顶点u并入相邻顶点v，不产生新顶点，
+// 所有级别共用原始顶点缓冲，蒙皮权重等属性不需要插值
+// 纹理接缝（同位置多个顶点）、边界和非流形边上的顶点锁定不动，保证各级别外轮廓与UV不撕裂
+// 顶点类型只需有position.x/y/z
+class LodBuilder
+{
+public:
+    // 生成LOD链：levels[0]为原始索引，之后每级目标为上一级的LOD_LEVEL_RATIO
+    // lodIndices为第1级起各级索引的拼接，levels中的firstIndex相对 indices + lodIndices 的整体
+    template <class V>
+    static void build(const std::vector<V> &vertices, const std::vector<unsigned int> &indices,
+                      std::vector<unsigned int> &lodIndices, std::vector<LodLevel> &levels)
+    {
+        lodIndices.clear();
+        levels.assign(1, LodLevel{0, static_cast<uint32_t>(indices.size()), 0.0f});
+        std::vector<size_t> targets;
+        float target = static_cast<float>(indices.size() / 3);
+        for (int i = 1; i < LOD_MAX_LEVELS; ++i)
+        {
+            target *= LOD_LEVEL_RATIO;
+            targets.push_back(static_cast<size_t>(target) * 3);
+        }
+        std::vector<float> errors;
+        auto chain = simplify(vertices, indices, targets, LOD_MAX_RELATIVE_ERROR * extent(vertices), errors);
+        for (size_t i = 0; i < chain.size(); ++i)
+        {
+            if (chain[i].empty() || chain[i].size() > LOD_MIN_REDUCTION * levels.back().indexNum)
+                break;
+            VertexCache::optimizeCache(chain[i], vertices.size());
+            levels.push_back(LodLevel{static_cast<uint32_t>(indices.size() + lodIndices.size()),
+                                      static_cast<uint32_t>(chain[i].size()),
+                                      fmaxf(errors[i], levels.back().error)});
+            lodIndices.insert(lodIndices.end(), chain[i].begin(), chain[i].end());
+        }
+    }
+    // 按误差从小到大折叠，三角形索引数依次降到targets（须递减）时各输出一份；
+    // 误差超过maxError或无边可折时提前结束，此时最后一份为结束时的状态（若与上一份不同）
+    // errors[i]为第i份结果的误差，单位同顶点坐标
+    template <class V>
+    static std::vector<std::vector<unsigned int>> simplify(const std::vector<V> &vertices, const std::vector<unsigned int> &indices,
+                                                           const std::vector<size_t> &targets, float maxError, std::vector<float> &errors)
+    {
+        std::vector<std::vector<unsigned int>> out;
+        errors.clear();
+        const size_t vertexNum = vertices.size();
+        const size_t triNum = indices.size() / 3;
+        for (size_t i = 0; i < triNum * 3; ++i)
+            if (indices[i] >= vertexNum)
+                return out;
+        std::vector<uint32_t> tris(indices.begin(), indices.begin() + triNum * 3);
+        std::vector<uint8_t> alive(triNum, 1);
+        std::vector<std::vector<uint32_t>> adjacency(vertexNum); // 顶点所在的三角形，可能含已删除的
+        for (size_t t = 0; t < triNum; ++t)
+            for (int k = 0; k < 3; ++k)
+                adjacency[tris[3 * t + k]].push_back(static_cast<uint32_t>(t));
+        std::vector<uint8_t> kind = classify(vertices, tris);
+        std::vector<Quadric> quadrics(vertexNum);
+        for (size_t t = 0; t < triNum; ++t)
+        {
+            Quadric q = Quadric::fromTriangle(position(vertices, tris[3 * t]), position(vertices, tris[3 * t + 1]), position(vertices, tris[3 * t + 2]));
+            for (int k = 0; k < 3; ++k)
+                quadrics[tris[3 * t + k]].add(q);
+        }
+
+        // 每个可移动顶点在堆中最多一个有效条目，即并入各邻居中代价最小的一个，旧条目因版本号失效
+        // 邻居并入v只给v的二次误差增加一项，到v的代价变化很小，因此不立即重新估价，出堆时再按当前代价重排
+        std::vector<uint32_t> version(vertexNum, 0);
+        std::vector<uint8_t> queued(vertexNum, 0);
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+        std::vector<uint32_t> neighboursU, neighboursV;
+        std::vector<Collapse> candidates;
+        auto cost = [&](uint32_t u, uint32_t v)
+        {
+            Quadric q = quadrics[u];
+            q.add(quadrics[v]);
+            return q.error(position(vertices, v));
+        };
+        auto evaluate = [&](uint32_t u)
+        {
+            if (MOVABLE != kind[u])
+                return;
+            ++version[u];
+            gatherNeighbours(tris, alive, adjacency, u, neighboursU);
+            Collapse best{FLT_MAX, u, u, version[u]};
+            for (uint32_t w : neighboursU)
+                if (SEAM != kind[w])
+                {
+                    float e = cost(u, w);
+                    if (e < best.error)
+                        best = Collapse{e, u, w, version[u]};
+                }
+            queued[u] = best.v != u;
+            if (queued[u])
+                heap.push(best);
+        };
+        for (uint32_t u = 0; u < vertexNum; ++u)
+            evaluate(u);
+
+        size_t aliveNum = triNum;
+        size_t next = 0;
+        float error = 0.0f;
+        bool changed = false;
+        while (next < targets.size())
+        {
+            if (aliveNum * 3 <= targets[next])
+            {
+                out.push_back(collect(tris, alive));
+                errors.push_back(error);
+                ++next;
+                changed = false;
+                continue;
+            }
+            if (heap.empty() || heap.top().error > maxError)
+                break;
+            Collapse top = heap.top();
+            heap.pop();
+            if (top.version != version[top.u])
+                continue;
+            queued[top.u] = 0;
+            // 按代价从小到大找第一个合法的目标，它比堆顶贵时放回堆中，保持整体按代价顺序折叠；都不合法时等邻域变化后再估价
+            gatherNeighbours(tris, alive, adjacency, top.u, neighboursU);
+            candidates.clear();
+            for (uint32_t w : neighboursU)
+                if (SEAM != kind[w])
+                    candidates.push_back(Collapse{cost(top.u, w), top.u, w, top.version});
+            std::sort(candidates.begin(), candidates.end(), [](const Collapse &l, const Collapse &r)
+                      { return l.error < r.error; });
+            const Collapse *chosen = nullptr;
+            for (auto &candidate : candidates)
+            {
+                if (candidate.error > maxError)
+                    break;
+                if (!canCollapse(vertices, tris, alive, adjacency, candidate.u, candidate.v, neighboursU, neighboursV))
+                    continue;
+                if (candidate.error > top.error)
+                {
+                    heap.push(candidate);
+                    queued[top.u] = 1;
+                }
+                else
+                    chosen = &candidate;
+                break;
+            }
+            if (nullptr == chosen)
+                continue;
+            const uint32_t u = chosen->u, v = chosen->v;
+            for (uint32_t t : adjacency[u])
+            {
+                if (!alive[t])
+                    continue;
+                uint32_t *tri = &tris[3 * t];
+                if (tri[0] == v || tri[1] == v || tri[2] == v)
+                {
+                    alive[t] = 0;
+                    --aliveNum;
+                    continue;
+                }
+                for (int k = 0; k < 3; ++k)
+                    if (tri[k] == u)
+                        tri[k] = v;
+                adjacency[v].push_back(t);
+            }
+            std::vector<uint32_t>().swap(adjacency[u]);
+            quadrics[v].add(quadrics[u]);
+            kind[u] = LOCKED; // 已删除，不再出现在任何三角形中
+            ++version[u];
+            error = fmaxf(error, chosen->error);
+            changed = true;
+            // v自身重新估价；邻居中此前没有合法折叠的，邻域变了，再试一次
+            compactAdjacency(adjacency[v], alive);
+            gatherNeighbours(tris, alive, adjacency, v, neighboursV);
+            evaluate(v);
+            for (uint32_t w : neighboursV)
+                if (!queued[w])
+                    evaluate(w);
+        }
+        if (changed && next < targets.size())
+        {
+            out.push_back(collect(tris, alive));
+            errors.push_back(error);
+        }
+        return out;
+    }
+    // 包围盒对角线长度
+    template <class V>
+    static float extent(const std::vector<V> &vertices)
+    {
+        if (vertices.empty())
+            return 0.0f;
+        double lo[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+        double hi[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+        for (auto &v : vertices)
+        {
+            const double p[3] = {v.position.x, v.position.y, v.position.z};
+            for (int k = 0; k < 3; ++k)
+            {
+                lo[k] = std::min(lo[k], p[k]);
+                hi[k] = std::max(hi[k], p[k]);
+            }
+        }
+        return static_cast<float>(sqrt((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1]) + (hi[2] - lo[2]) * (hi[2] - lo[2])));
+    }
+
+private:
+    enum : uint8_t
+    {
+        MOVABLE = 0, // 可以并入邻居
+        LOCKED = 1,  // 边界或非流形，只能作为折叠目标
+        SEAM = 2     // 与其他顶点同位置，既不能移动也不能作为目标（目标不唯一）
+    };
+    struct Vec
+    {
+        double x, y, z;
+    };
+    // 平面距离平方的面积加权和，w为权重总和，error按权重归一化后开方，得到平均意义下的距离
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        double b0 = 0, b1 = 0, b2 = 0, c = 0, w = 0;
+
+        static Quadric fromTriangle(const Vec &p0, const Vec &p1, const Vec &p2)
+        {
+            Quadric q;
+            Vec e1{p1.x - p0.x, p1.y - p0.y, p1.z - p0.z};
+            Vec e2{p2.x - p0.x, p2.y - p0.y, p2.z - p0.z};
+            Vec n{e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x};
+            double len = sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+            if (len <= 0.0)
+                return q;
+            n = {n.x / len, n.y / len, n.z / len};
+            double d = -(n.x * p0.x + n.y * p0.y + n.z * p0.z);
+            double area = 0.5 * len;
+            q.a00 = area * n.x * n.x;
+            q.a01 = area * n.x * n.y;
+            q.a02 = area * n.x * n.z;
+            q.a11 = area * n.y * n.y;
+            q.a12 = area * n.y * n.z;
+            q.a22 = area * n.z * n.z;
+            q.b0 = area * n.x * d;
+            q.b1 = area * n.y * d;
+            q.b2 = area * n.z * d;
+            q.c = area * d * d;
+            q.w = area;
+            return q;
+        }
+        void add(const Quadric &o)
+        {
+            a00 += o.a00;
+            a01 += o.a01;
+            a02 += o.a02;
+            a11 += o.a11;
+            a12 += o.a12;
+            a22 += o.a22;
+            b0 += o.b0;
+            b1 += o.b1;
+            b2 += o.b2;
+            c += o.c;
+            w += o.w;
+        }
+        float error(const Vec &p) const
+        {
+            double e = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+                       2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+                       2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+            return w > 0.0 ? static_cast<float>(sqrt(fmax(e, 0.0) / w)) : 0.0f;
+        }
+    };
+    struct Collapse
+    {
+        float error;
+        uint32_t u, v;    // u并入v
+        uint32_t version; // 入堆时u的版本号
+        bool operator>(const Collapse &o) const { return error > o.error; }
+    };
+
+    template <class V>
+    static Vec position(const std::vector<V> &vertices, uint32_t i)
+    {
+        return Vec{vertices[i].position.x, vertices[i].position.y, vertices[i].position.z};
+    }
+    template <class V>
+    static std::vector<uint8_t> classify(const std::vector<V> &vertices, const std::vector<uint32_t> &tris)
+    {
+        std::vector<uint8_t> kind(vertices.size(), MOVABLE);
+        // 同位置的顶点：按坐标排序后相邻比较
+        std::vector<uint32_t> order(vertices.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = static_cast<uint32_t>(i);
+        auto less = [&vertices](uint32_t l, uint32_t r)
+        {
+            auto &a = vertices[l].position;
+            auto &b = vertices[r].position;
+            return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+        };
+        std::sort(order.begin(), order.end(), less);
+        for (size_t i = 1; i < order.size(); ++i)
+            if (!less(order[i - 1], order[i]))
+                kind[order[i - 1]] = kind[order[i]] = SEAM;
+        // 只属于一个三角形的边是边界，属于三个以上的是非流形
+        std::vector<uint64_t> edges;
+        edges.reserve(tris.size());
+        for (size_t t = 0; t + 2 < tris.size(); t += 3)
+            for (int k = 0; k < 3; ++k)
+            {
+                uint64_t a = tris[t + k];
+                uint64_t b = tris[t + (k + 1) % 3];
+                edges.push_back(a < b ? (a << 32 | b) : (b << 32 | a));
+            }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();)
+        {
+            size_t j = i;
+            while (j < edges.size() && edges[j] == edges[i])
+                ++j;
+            if (2 != j - i)
+                for (uint32_t v : {static_cast<uint32_t>(edges[i] >> 32), static_cast<uint32_t>(edges[i])})
+                    if (SEAM != kind[v])
+                        kind[v] = LOCKED;
+            i = j;
+        }
+        return kind;
+    }
+    static void compactAdjacency(std::vector<uint32_t> &adjacent, const std::vector<uint8_t> &alive)
+    {
+        adjacent.erase(std::remove_if(adjacent.begin(), adjacent.end(), [&alive](uint32_t t)
+                                      { return !alive[t]; }),
+                       adjacent.end());
+    }
+    // 拓扑：u、v的公共邻居只能是边uv两侧的两个顶点，否则折叠后出现重叠面
+    // 几何：u的其余三角形换成v后法线不能翻转或偏转过大
+    template <class V>
+    static bool canCollapse(const std::vector<V> &vertices, const std::vector<uint32_t> &tris, const std::vector<uint8_t> &alive,
+                            const std::vector<std::vector<uint32_t>> &adjacency, uint32_t u, uint32_t v,
+                            std::vector<uint32_t> &neighboursU, std::vector<uint32_t> &neighboursV)
+    {
+        neighboursU.clear();
+        neighboursV.clear();
+        int shared = 0;
+        for (uint32_t t : adjacency[u])
+        {
+            if (!alive[t])
+                continue;
+            const uint32_t *tri = &tris[3 * t];
+            bool hasV = tri[0] == v || tri[1] == v || tri[2] == v;
+            shared += hasV;
+            for (int k = 0; k < 3; ++k)
+                if (tri[k] != u)
+                    neighboursU.push_back(tri[k]);
+            if (hasV)
+                continue;
+            Vec p[3], q[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                p[k] = position(vertices, tri[k]);
+                q[k] = tri[k] == u ? position(vertices, v) : p[k];
+            }
+            Vec n0 = normal(p), n1 = normal(q);
+            double d = n0.x * n1.x + n0.y * n1.y + n0.z * n1.z;
+            double l0 = sqrt(n0.x * n0.x + n0.y * n0.y + n0.z * n0.z);
+            double l1 = sqrt(n1.x * n1.x + n1.y * n1.y + n1.z * n1.z);
+            if (d <= 0.25 * l0 * l1)
+                return false;
+        }
+        if (2 != shared)
+            return false;
+        std::sort(neighboursU.begin(), neighboursU.end());
+        neighboursU.erase(std::unique(neighboursU.begin(), neighboursU.end()), neighboursU.end());
+        gatherNeighbours(tris, alive, adjacency, v, neighboursV);
+        size_t common = 0;
+        for (size_t i = 0, j = 0; i < neighboursU.size() && j < neighboursV.size();)
+            if (neighboursU[i] < neighboursV[j])
+                ++i;
+            else if (neighboursV[j] < neighboursU[i])
+                ++j;
+            else
+            {
+                common += neighboursU[i] != u && neighboursU[i] != v;
+                ++i;
+                ++j;
+            }
+        return 2 == common;
+    }
+    // 有序去重
+    static void gatherNeighbours(const std::vector<uint32_t> &tris, const std::vector<uint8_t> &alive,
+                                 const std::vector<std::vector<uint32_t>> &adjacency, uint32_t v, std::vector<uint32_t> &neighbours)
+    {
+        neighbours.clear();
+        for (uint32_t t : adjacency[v])
+            if (alive[t])
+                for (int k = 0; k < 3; ++k)
+                    if (tris[3 * t + k] != v)
+                        neighbours.push_back(tris[3 * t + k]);
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    }
+    static Vec normal(const Vec p[3])
+    {
+        Vec e1{p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z};
+        Vec e2{p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z};
+        return Vec{e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x};
+    }
+    static std::vector<unsigned int> collect(const std::vector<uint32_t> &tris, const std::vector<uint8_t> &alive)
+    {
+        std::vector<unsigned int> out;
+        for (size_t t = 0; t < alive.size(); ++t)
+            if (alive[t])
+                out.insert(out.end(), tris.begin() + 3 * t, tris.begin() + 3 * t + 3);
+        return out;
+    }
+};
+
+// 按屏幕空间误差选级别，每个对象每帧一次
+struct LodSelector
+{
+    // 距离1处单位长度投影到屏幕上的像素数，每帧一次；projection11为投影矩阵的[1][1]（1/tan(fovy/2)）
+    static float lodScale(float projection11, float viewportHeight) { return 0.5f * projection11 * viewportHeight; }
+    // 距离distance处局部空间单位长度的像素数，scale为模型矩阵的最大轴向缩放
+    static float pixelsPerUnit(float lodScale, float distance, float scale) { return lodScale * scale / fmaxf(distance, 1e-3f); }
+    // errors须单调不减（LodBuilder保证），errors[0]为0
+    // 当前级别的投影误差在阈值的(1 + LOD_HYSTERESIS)倍以内时保留，
+    // 换到更粗的级别要求其误差在(1 - LOD_HYSTERESIS)倍以内
+    // rt: 新的级别
+    static int select(const float *errors, int levelNum, float pixelsPerUnit, int current)
+    {
+        if (levelNum <= 1)
+            return 0;
+        current = std::clamp(current, 0, levelNum - 1);
+        int finer = coarsest(errors, levelNum, pixelsPerUnit, LOD_PIXEL_ERROR * (1.0f + LOD_HYSTERESIS));
+        if (current > finer)
+            return finer;
+        return std::max(current, coarsest(errors, levelNum, pixelsPerUnit, LOD_PIXEL_ERROR * (1.0f - LOD_HYSTERESIS)));
+    }
+
+private:
+    static int coarsest(const float *errors, int levelNum, float pixelsPerUnit, float pixels)
+    {
+        int level = 0;
+        while (level + 1 < levelNum && errors[level + 1] * pixelsPerUnit <= pixels)
+            ++level;
+        return level;
+    }
+};
+
+#endif
@@ -1,24 +1,24 @@
 #include <string>
 #include <vector>
-#include <glad/glad.h>
+#include <algorithm>
+#include <stdint.h>
+#include <iostream>
 #include <glm/glm.hpp>
+#include "vertexFormat.hpp"
+#include "frustum.hpp"
+#include "lod.hpp"
+#ifndef BBG_HEADLESS
+#include <glad/glad.h>
 #include "shader.hpp"
+#include "renderState.hpp"
+#endif
 
 #ifndef MESH_HPP
 #define MESH_HPP
 
-#define MAX_BONE_INFLUENCE 4
-
-struct Vertex
-{
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 texCoords;
-    glm::vec3 tangent;
-    glm::vec3 bitangent;
-    int boneIDs[MAX_BONE_INFLUENCE];
-    float weights[MAX_BONE_INFLUENCE];
-};
+#ifdef BBG_HEADLESS
+typedef unsigned int GLuint; // 与glad一致，无头模式下只保留CPU侧数据，不创建任何GL对象
+#endif
 
 struct Texture
 {
@@ -30,55 +30,55 @@ struct Texture
 class Mesh
 {
     std::vector<Vertex> vertices_;
-    std::vector<GLuint> indices_;
+    std::vector<GLuint> indices_;    // 原始级别，碰撞检测等CPU侧读取
+    std::vector<GLuint> lodIndices_; // 更粗的各级别，接在indices_之后上传到同一个EBO
+    std::vector<LodLevel> lods_;     // 至少一级，lods_[0]即indices_
     std::vector<Texture> textures_;
     std::string name_;
+    std::vector<uint64_t> samplerHashes_; // 与textures_一一对应，绘制时按哈希查uniform
+    uint64_t materialKey_;                // 纹理与sampler相同的mesh相同，渲染队列按它排序与合并绑定
+    Bounds bounds_;                       // 局部空间，构造时计算
     GLuint VAO_, VBO_, EBO_;
 
 public:
     Mesh(const std::string &name,
          const std::vector<Vertex> &vertices,
          const std::vector<unsigned int> &indices,
-         const std::vector<Texture> &textures)
+         const std::vector<Texture> &textures,
+         const std::vector<unsigned int> &lodIndices = {},
+         const std::vector<LodLevel> &lods = {})
         : vertices_(vertices),
           indices_(indices),
+          lodIndices_(lodIndices),
+          lods_(lods),
           textures_(textures),
           name_(name),
+          materialKey_(0),
           VAO_(0),
           VBO_(0),
           EBO_(0)
     {
-        glGenVertexArrays(1, &VAO_);
-        glGenBuffers(1, &VBO_);
-        glGenBuffers(1, &EBO_);
-        glBindVertexArray(VAO_);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-        glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(Vertex), &vertices_[0], GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(unsigned int), &indices_[0], GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, texCoords));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, tangent));
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, bitangent));
-        glEnableVertexAttribArray(4);
-        glVertexAttribIPointer(5, MAX_BONE_INFLUENCE, GL_INT, sizeof(Vertex), (void *)offsetof(Vertex, boneIDs));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(6, MAX_BONE_INFLUENCE, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, weights));
-        glEnableVertexAttribArray(6);
-        glBindVertexArray(0);
+        if (lods_.empty())
+            lods_.push_back(LodLevel{0, static_cast<uint32_t>(indices_.size()), 0.0f});
+        for (auto &vertex : vertices_)
+            bounds_.expand(vertex.position);
+        bounds_.finish(vertices_);
+#ifndef BBG_HEADLESS
+        setupGL();
+#endif
     }
     Mesh(const Mesh &) = delete;
     Mesh &operator=(const Mesh &) = delete;
     Mesh(Mesh &&other)
         : vertices_(std::move(other.vertices_)),
           indices_(std::move(other.indices_)),
+          lodIndices_(std::move(other.lodIndices_)),
+          lods_(std::move(other.lods_)),
           textures_(std::move(other.textures_)),
           name_(std::move(other.name_)),
+          samplerHashes_(std::move(other.samplerHashes_)),
+          materialKey_(other.materialKey_),
+          bounds_(other.bounds_),
           VAO_(other.VAO_),
           VBO_(other.VBO_),
           EBO_(other.EBO_)
@@ -95,39 +95,127 @@ public:
     }
     ~Mesh()
     {
-        glDeleteVertexArrays(1, &VAO_);
+#ifndef BBG_HEADLESS
+        GLStateCache::getInstance().deleteVertexArray(VAO_);
         glDeleteBuffers(1, &VBO_);
         glDeleteBuffers(1, &EBO_);
+#endif
+    }
+#ifndef BBG_HEADLESS
+    // lod超出时用最粗的一级；绘制后不解绑，VAO与纹理留给下一次绘制比较
+    void draw(Shader &shader, int lod = 0) const
+    {
+        bindTextures(shader);
+        drawElements(lod);
     }
-    void draw(Shader &shader) const
+    // 按纹理类型名绑定到对应的sampler，纹理单元依次为0、1、2...
+    void bindTextures(Shader &shader) const
     {
         for (unsigned int i = 0; i < textures_.size(); ++i)
         {
-            glActiveTexture(GL_TEXTURE0 + i);
-            glUniform1i(glGetUniformLocation(shader.getID(), textures_[i].type.c_str()), i);
-            glBindTexture(GL_TEXTURE_2D, textures_[i].id);
+            glUniform1i(shader.location(samplerHashes_[i]), i);
+            GLStateCache::getInstance().bindTexture(i, textures_[i].id);
         }
-        // //////////////////////////////////////////////////////////////////////////////////////////////////////
-        // for (auto &it : vertices_)
-        //     std::clog << "x" << it.position.x << "y" << it.position.y << "z" << it.position.z << "\n";
-        // std::clog << "\n";
-        // //////////////////////////////////////////////////////////////////////////////////////////////////////
-        glBindVertexArray(VAO_);
-        glDrawElements(GL_TRIANGLES, static_cast<GLuint>(indices_.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-        glActiveTexture(GL_TEXTURE0);
     }
+    // 只绑定VAO并绘制，纹理与模型矩阵由调用者设置
+    void drawElements(int lod = 0) const
+    {
+        const LodLevel &level = getLod(lod);
+        GLStateCache::getInstance().bindVertexArray(VAO_);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(level.indexNum), GL_UNSIGNED_INT, (void *)(level.firstIndex * sizeof(GLuint)));
+    }
+    // 模型矩阵取自attachInstanceBuffer绑定的实例缓冲，从第baseInstance个起绘制count个实例
+    void drawInstanced(Shader &shader, GLsizei count, int lod = 0, GLuint baseInstance = 0) const
+    {
+        const LodLevel &level = getLod(lod);
+        bindTextures(shader);
+        GLStateCache::getInstance().bindVertexArray(VAO_);
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, static_cast<GLsizei>(level.indexNum), GL_UNSIGNED_INT,
+                                            (void *)(level.firstIndex * sizeof(GLuint)), count, baseInstance);
+    }
+    // 把实例缓冲（紧密排列的glm::mat4）接到本mesh的VAO上，每个缓冲只需调用一次
+    void attachInstanceBuffer(GLuint instanceVBO)
+    {
+        GLStateCache::getInstance().bindVertexArray(VAO_);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        setupInstanceAttributes();
+    }
+    GLuint getVertexArray() const { return VAO_; }
+#endif
     std::string getName() const { return name_; }
     std::vector<Vertex> &getVertices() { return vertices_; }
     std::vector<GLuint> &getIndices() { return indices_; }
+    const std::vector<GLuint> &getLodIndices() const { return lodIndices_; }
+    const std::vector<LodLevel> &getLods() const { return lods_; }
+    const LodLevel &getLod(int lod) const { return lods_[std::clamp(lod, 0, static_cast<int>(lods_.size()) - 1)]; }
+    const std::vector<Texture> &getTextures() const { return textures_; }
+    const Bounds &getBounds() const { return bounds_; }
+    uint64_t getMaterialKey() const { return materialKey_; }
 
 private:
+#ifndef BBG_HEADLESS
+    // 上传CPU侧数据到GPU，必须在GL上下文中调用
+    // 有骨骼影响的mesh上传为SkinnedVertex，否则为StaticVertex；CPU侧仍保留完整的Vertex
+    void setupGL()
+    {
+        materialKey_ = 14695981039346656037ull; // FNV-1a，依次混入纹理名与sampler哈希
+        for (auto &texture : textures_)
+        {
+            samplerHashes_.push_back(uniformHash(texture.type));
+            for (uint64_t word : {static_cast<uint64_t>(texture.id), samplerHashes_.back()})
+            {
+                materialKey_ ^= word;
+                materialKey_ *= 1099511628211ull;
+            }
+        }
+        bool skinned = false;
+        for (auto &vertex : vertices_)
+            for (int i = 0; i < MAX_BONE_INFLUENCE && !skinned; ++i)
+                skinned = vertex.boneIDs[i] >= 0;
+        glGenVertexArrays(1, &VAO_);
+        glGenBuffers(1, &VBO_);
+        glGenBuffers(1, &EBO_);
+        GLStateCache::getInstance().bindVertexArray(VAO_);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+        if (skinned)
+        {
+            bool overflow = false;
+            std::vector<SkinnedVertex> packed;
+            packed.reserve(vertices_.size());
+            for (auto &vertex : vertices_)
+                packed.push_back(SkinnedVertex::pack(vertex, overflow));
+            if (overflow)
+                std::cerr << "Bone index out of range, influences dropped: " << name_ << std::endl;
+            glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(SkinnedVertex), packed.data(), GL_STATIC_DRAW);
+            SkinnedVertex::setupAttributes();
+        }
+        else
+        {
+            std::vector<StaticVertex> packed;
+            packed.reserve(vertices_.size());
+            for (auto &vertex : vertices_)
+                packed.push_back(StaticVertex::pack(vertex));
+            glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(StaticVertex), packed.data(), GL_STATIC_DRAW);
+            StaticVertex::setupAttributes();
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (indices_.size() + lodIndices_.size()) * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices_.size() * sizeof(unsigned int), indices_.data());
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(unsigned int), lodIndices_.size() * sizeof(unsigned int), lodIndices_.data());
+        GLStateCache::getInstance().bindVertexArray(0);
+    }
+#endif
     void swap(Mesh &other)
     {
         std::swap(vertices_, other.vertices_);
         std::swap(indices_, other.indices_);
+        std::swap(lodIndices_, other.lodIndices_);
+        std::swap(lods_, other.lods_);
         std::swap(textures_, other.textures_);
         std::swap(name_, other.name_);
+        std::swap(samplerHashes_, other.samplerHashes_);
+        std::swap(materialKey_, other.materialKey_);
+        std::swap(bounds_, other.bounds_);
         std::swap(VAO_, other.VAO_);
         std::swap(VBO_, other.VBO_);
         std::swap(EBO_, other.EBO_);
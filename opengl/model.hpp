@@ -2,17 +2,28 @@
 #include <string>
 #include <filesystem>
 #include <vector>
+#include <span>
 #include <unordered_map>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
+#ifndef BBG_HEADLESS
 #include <stb/stb_image.h>
+#include "renderQueue.hpp"
+#endif
 #include "mesh.hpp"
 #include "converter.hpp"
+#include "vertexCache.hpp"
+#include "lod.hpp"
 
 #ifndef MODEL_HPP
 #define MODEL_HPP
 
+// 为1时加载模型输出每个mesh顶点缓存优化前后的ACMR
+#define MODEL_VCACHE_REPORT 0
+// 为1时加载模型输出每个mesh各LOD级别的三角形数与误差
+#define MODEL_LOD_REPORT 0
+
 struct Hierarchy
 {
     int id = -1;
@@ -28,11 +39,19 @@ class Model
     std::vector<Mesh> meshes_;
     std::vector<Texture> texturesLoaded_;
     std::unordered_map<std::string, Hierarchy> bonesLoaded_;
+    GLuint instanceVBO_;        // 所有mesh共享的实例矩阵缓冲，首次实例化绘制时创建
+    size_t instanceCapacity_;   // 以glm::mat4计
+    Bounds bounds_;             // 所有mesh的并集，局部空间
+    SphereCuller culler_;       // 逐mesh剔除用
+    std::vector<uint8_t> visible_;
+    std::vector<float> lodErrors_; // 每级取所有mesh中最大的误差，mesh级别不够时按其最粗一级计
 
 public:
     Model(const std::filesystem::path &path)
         : path_(path),
-          root_(nullptr)
+          root_(nullptr),
+          instanceVBO_(0),
+          instanceCapacity_(0)
     {
         Assimp::Importer importer;
         const aiScene *paiScene = importer.ReadFile(path_,
@@ -46,12 +65,27 @@ public:
                !(paiScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) &&
                paiScene->mRootNode != nullptr);
         processNode(root_, paiScene->mRootNode, paiScene);
+        for (auto &mesh : meshes_)
+            bounds_.expand(mesh.getBounds());
+        bounds_.finish();
+        culler_.resize(meshes_.size());
+        for (auto &mesh : meshes_)
+            if (mesh.getLods().size() > lodErrors_.size())
+                lodErrors_.resize(mesh.getLods().size(), 0.0f);
+        for (size_t level = 0; level < lodErrors_.size(); ++level)
+            for (auto &mesh : meshes_)
+                lodErrors_[level] = fmaxf(lodErrors_[level], mesh.getLod(static_cast<int>(level)).error);
+        if (lodErrors_.empty())
+            lodErrors_.push_back(0.0f);
     }
     ~Model()
     {
         root_ = nullptr;
+#ifndef BBG_HEADLESS
         for (auto &texture : texturesLoaded_)
-            glDeleteTextures(1, &texture.id);
+            GLStateCache::getInstance().deleteTexture(texture.id);
+        glDeleteBuffers(1, &instanceVBO_);
+#endif
     }
     void swap(Model &other)
     {
@@ -60,6 +94,12 @@ public:
         std::swap(meshes_, other.meshes_);
         std::swap(texturesLoaded_, other.texturesLoaded_);
         std::swap(bonesLoaded_, other.bonesLoaded_);
+        std::swap(instanceVBO_, other.instanceVBO_);
+        std::swap(instanceCapacity_, other.instanceCapacity_);
+        std::swap(bounds_, other.bounds_);
+        std::swap(culler_, other.culler_);
+        std::swap(visible_, other.visible_);
+        std::swap(lodErrors_, other.lodErrors_);
     }
     Model(const Model &) = delete;
     Model &operator=(const Model &) = delete;
@@ -68,9 +108,17 @@ public:
           root_(other.root_),
           meshes_(std::move(other.meshes_)),
           texturesLoaded_(std::move(other.texturesLoaded_)),
-          bonesLoaded_(std::move(other.bonesLoaded_))
+          bonesLoaded_(std::move(other.bonesLoaded_)),
+          instanceVBO_(other.instanceVBO_),
+          instanceCapacity_(other.instanceCapacity_),
+          bounds_(other.bounds_),
+          culler_(std::move(other.culler_)),
+          visible_(std::move(other.visible_)),
+          lodErrors_(std::move(other.lodErrors_))
     {
         other.root_ = nullptr;
+        other.instanceVBO_ = 0;
+        other.instanceCapacity_ = 0;
     }
     Model &operator=(Model &&other)
     {
@@ -82,13 +130,110 @@ public:
     inline std::unordered_map<std::string, Hierarchy> &getBonesLoaded() { return bonesLoaded_; }
     inline Hierarchy *getRootHierarchy() const { return root_; }
     inline std::vector<Mesh> &getMeshes() { return meshes_; }
+    inline const Bounds &getBounds() const { return bounds_; }
+    inline int getLodNum() const { return static_cast<int>(lodErrors_.size()); }
+    // 按屏幕空间误差为一个对象选级别，current为该对象上一帧的级别，lodScale见LodSelector::lodScale
+    // rt: 本帧的级别
+    int selectLod(const glm::mat4 &globalMat, const glm::vec3 &viewPos, float lodScale, int current) const
+    {
+        if (lodErrors_.size() <= 1 || bounds_.empty())
+            return 0;
+        glm::vec3 center;
+        float radius;
+        bounds_.transformSphere(globalMat, center, radius);
+        glm::vec3 d = center - viewPos;
+        float distance = sqrtf(glm::dot(d, d)) - radius;
+        float scale = bounds_.radius > 0.0f ? radius / bounds_.radius : 1.0f;
+        return LodSelector::select(lodErrors_.data(), static_cast<int>(lodErrors_.size()),
+                                   LodSelector::pixelsPerUnit(lodScale, distance, scale), current);
+    }
+#ifndef BBG_HEADLESS
     void draw(Shader &shader) const
     {
         for (auto &mesh : meshes_)
             mesh.draw(shader);
     }
+    // 只提交与视锥相交的mesh，按到viewPos的距离放入queue，由RenderQueue::flush排序后绘制
+    // model为shader中模型矩阵的uniform，globalMat为其取值
+    // rt: 放入的mesh数
+    size_t submit(RenderQueue &queue, Shader &shader, Uniform<glm::mat4> model, const Frustum &frustum,
+                  const glm::mat4 &globalMat, const glm::vec3 &viewPos, int lod = 0)
+    {
+        if (!cullMeshes(frustum, globalMat))
+            return 0;
+        size_t submitted = 0;
+        for (size_t i = 0; i < meshes_.size(); ++i)
+            if (visible_[i])
+            {
+                glm::vec3 center;
+                float radius;
+                meshes_[i].getBounds().transformSphere(globalMat, center, radius);
+                glm::vec3 d = center - viewPos;
+                queue.submit(shader, model, meshes_[i], globalMat, sqrtf(glm::dot(d, d)) - radius, lod);
+                ++submitted;
+            }
+        return submitted;
+    }
+    // 每个mesh每个级别一次glDrawElementsInstancedBaseInstance，shader须从INSTANCE_MATRIX_LOCATION读取模型矩阵
+    // globalMats按级别从细到粗排列，lodCounts[i]为第i级的实例数；lodCounts为空时全部按第0级绘制
+    void drawInstanced(Shader &shader, std::span<const glm::mat4> globalMats, std::span<const GLsizei> lodCounts = {})
+    {
+        if (globalMats.empty())
+            return;
+        uploadInstances(globalMats);
+        const GLsizei all = static_cast<GLsizei>(globalMats.size());
+        if (lodCounts.empty())
+            lodCounts = std::span<const GLsizei>(&all, 1);
+        for (auto &mesh : meshes_)
+        {
+            GLuint base = 0;
+            for (size_t level = 0; level < lodCounts.size(); ++level)
+            {
+                if (lodCounts[level] > 0)
+                    mesh.drawInstanced(shader, lodCounts[level], static_cast<int>(level), base);
+                base += static_cast<GLuint>(lodCounts[level]);
+            }
+        }
+    }
+#endif
 
 private:
+#ifndef BBG_HEADLESS
+    // 整体包围球在视锥外时返回false，否则逐mesh剔除，结果写入visible_
+    bool cullMeshes(const Frustum &frustum, const glm::mat4 &globalMat)
+    {
+        glm::vec3 center;
+        float radius;
+        bounds_.transformSphere(globalMat, center, radius);
+        if (bounds_.empty() || !frustum.sphereVisible(center, radius))
+            return false;
+        for (size_t i = 0; i < meshes_.size(); ++i)
+        {
+            meshes_[i].getBounds().transformSphere(globalMat, center, radius);
+            culler_.set(i, center, radius);
+        }
+        culler_.cull(frustum, visible_);
+        return true;
+    }
+    // 容量按2倍增长；每帧先孤立旧存储再写入，不等待上一帧的绘制读完
+    void uploadInstances(std::span<const glm::mat4> globalMats)
+    {
+        if (0 == instanceVBO_)
+        {
+            glGenBuffers(1, &instanceVBO_);
+            for (auto &mesh : meshes_)
+                mesh.attachInstanceBuffer(instanceVBO_);
+        }
+        size_t capacity = instanceCapacity_ > 0 ? instanceCapacity_ : 16;
+        while (capacity < globalMats.size())
+            capacity <<= 1;
+        instanceCapacity_ = capacity;
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO_);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, globalMats.size() * sizeof(glm::mat4), globalMats.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+#endif
     void processNode(Hierarchy *&node, aiNode *paiNode, const aiScene *paiScene)
     {
         assert(paiNode != nullptr);
@@ -119,8 +264,27 @@ private:
         assert(paiScene != nullptr);
         std::vector<Vertex> vertices = processVertices(paiMesh);
         std::vector<unsigned int> indices = processIndices(paiMesh);
+#if MODEL_VCACHE_REPORT
+        double before = VertexCache::acmr(indices, vertices.size());
+#endif
+        VertexCache::optimizeMesh(vertices, indices);
+#if MODEL_VCACHE_REPORT
+        std::clog << "Mesh " << paiMesh->mName.C_Str() << ": " << indices.size() / 3 << " triangles, ACMR "
+                  << before << " -> " << VertexCache::acmr(indices, vertices.size()) << std::endl;
+#endif
+        std::vector<unsigned int> lodIndices;
+        std::vector<LodLevel> lods;
+#ifndef BBG_HEADLESS // 无头模式只做碰撞检测，不需要更粗的级别
+        LodBuilder::build(vertices, indices, lodIndices, lods);
+#if MODEL_LOD_REPORT
+        std::clog << "Mesh " << paiMesh->mName.C_Str() << " LOD:";
+        for (auto &level : lods)
+            std::clog << " " << level.indexNum / 3 << " (" << level.error << ")";
+        std::clog << std::endl;
+#endif
+#endif
         std::vector<Texture> textures = processTextures(paiMesh, paiScene);
-        return Mesh(paiMesh->mName.C_Str(), vertices, indices, textures);
+        return Mesh(paiMesh->mName.C_Str(), vertices, indices, textures, lodIndices, lods);
     }
     std::vector<Vertex> processVertices(aiMesh *paiMesh)
     {
@@ -208,13 +372,16 @@ private:
         assert(paiMesh != nullptr);
         assert(paiScene != nullptr);
         std::vector<Texture> textures;
+#ifndef BBG_HEADLESS // 无头模式不加载纹理
         aiMaterial *paiMaterial = paiScene->mMaterials[paiMesh->mMaterialIndex];
         loadMaterialTextures(textures, paiMaterial, aiTextureType_DIFFUSE, "texture_diffuse");
         loadMaterialTextures(textures, paiMaterial, aiTextureType_SPECULAR, "texture_specular");
         loadMaterialTextures(textures, paiMaterial, aiTextureType_HEIGHT, "texture_normal");
         loadMaterialTextures(textures, paiMaterial, aiTextureType_AMBIENT, "texture_height");
+#endif
         return textures;
     }
+#ifndef BBG_HEADLESS
     void loadMaterialTextures(std::vector<Texture> &textures, aiMaterial *paiMaterial, aiTextureType paiTextureType, const std::string &typeName)
     {
         assert(paiMaterial != nullptr);
@@ -277,6 +444,7 @@ private:
         stbi_image_free(pImage);
         return textureID;
     }
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "mesh.hpp"
+#include "renderState.hpp"
+
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+// 排序键各字段的位数，从高到低依次为program、材质、VAO、视深度
+#define RENDER_KEY_PROGRAM_BITS 12
+#define RENDER_KEY_MATERIAL_BITS 20
+#define RENDER_KEY_VAO_BITS 16
+#define RENDER_KEY_DEPTH_BITS 16
+static_assert(RENDER_KEY_PROGRAM_BITS + RENDER_KEY_MATERIAL_BITS + RENDER_KEY_VAO_BITS + RENDER_KEY_DEPTH_BITS == 64,
+              "render key fields must fill 64 bits");
+
+// 一次非实例化的mesh绘制，模型矩阵经由uniform设置
+struct DrawPacket
+{
+    Shader *shader;
+    const Mesh *mesh;
+    Uniform<glm::mat4> model;
+    glm::mat4 globalMat;
+    int lod;
+};
+
+// 一帧内收集绘制，按64位键排序后统一提交：同一program、材质、VAO的绘制相邻，经GLStateCache每组只绑定一次，
+// 组内按视深度从近到远，利于early-z
+// program与VAO取名字的低位，材质取哈希的高位；截断后的冲突只影响分组，提交时按真实值判断是否重新绑定
+class RenderQueue
+{
+    std::vector<DrawPacket> packets_;
+    std::vector<std::pair<uint64_t, uint32_t>> keys_; // 排序键与packets_的下标
+    size_t materialBinds_;                            // 上一次flush实际绑定材质的次数
+
+public:
+    RenderQueue() : materialBinds_(0) {}
+    ~RenderQueue() = default;
+    RenderQueue(const RenderQueue &) = delete;
+    RenderQueue &operator=(const RenderQueue &) = delete;
+    RenderQueue(RenderQueue &&) = delete;
+    RenderQueue &operator=(RenderQueue &&) = delete;
+
+    // viewDepth为到相机的距离，负数按0计；非负float的位模式与数值同序，直接取高位
+    static uint64_t makeKey(GLuint program, uint64_t materialKey, GLuint vertexArray, float viewDepth)
+    {
+        constexpr uint64_t programMask = (1ull << RENDER_KEY_PROGRAM_BITS) - 1;
+        constexpr uint64_t vertexArrayMask = (1ull << RENDER_KEY_VAO_BITS) - 1;
+        float depth = viewDepth > 0.0f ? viewDepth : 0.0f;
+        uint32_t depthBits;
+        memcpy(&depthBits, &depth, sizeof(depthBits));
+        return (static_cast<uint64_t>(program) & programMask) << (64 - RENDER_KEY_PROGRAM_BITS) |
+               (materialKey >> (64 - RENDER_KEY_MATERIAL_BITS)) << (RENDER_KEY_VAO_BITS + RENDER_KEY_DEPTH_BITS) |
+               (static_cast<uint64_t>(vertexArray) & vertexArrayMask) << RENDER_KEY_DEPTH_BITS |
+               static_cast<uint64_t>(depthBits >> (32 - RENDER_KEY_DEPTH_BITS));
+    }
+    // shader与mesh须存活到flush
+    void submit(Shader &shader, Uniform<glm::mat4> model, const Mesh &mesh, const glm::mat4 &globalMat, float viewDepth, int lod = 0)
+    {
+        keys_.emplace_back(makeKey(shader.getID(), mesh.getMaterialKey(), mesh.getVertexArray(), viewDepth),
+                           static_cast<uint32_t>(packets_.size()));
+        packets_.push_back(DrawPacket{&shader, &mesh, model, globalMat, lod});
+    }
+    // 排序并绘制所有已提交的packet，之后清空队列（保留容量）；结束时最后一个shader处于使用状态
+    // rt: 绘制数
+    size_t flush()
+    {
+        std::sort(keys_.begin(), keys_.end());
+        Shader *shader = nullptr;
+        const Mesh *material = nullptr; // 当前绑定的纹理来自这个mesh
+        materialBinds_ = 0;
+        for (auto &[key, index] : keys_)
+        {
+            const DrawPacket &packet = packets_[index];
+            if (packet.shader != shader)
+            {
+                shader = packet.shader;
+                shader->use();
+                material = nullptr; // sampler uniform属于program，换program后须重新设置
+            }
+            if (nullptr == material || material->getMaterialKey() != packet.mesh->getMaterialKey())
+            {
+                packet.mesh->bindTextures(*shader);
+                material = packet.mesh;
+                ++materialBinds_;
+            }
+            shader->set(packet.model, packet.globalMat);
+            packet.mesh->drawElements(packet.lod);
+        }
+        size_t drawn = packets_.size();
+        packets_.clear();
+        keys_.clear();
+        return drawn;
+    }
+    size_t size() const { return packets_.size(); }
+    bool empty() const { return packets_.empty(); }
+    size_t getMaterialBinds() const { return materialBinds_; }
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include <iostream>
+#include <stdint.h>
+#include <glad/glad.h>
+
+#ifndef RENDER_STATE_HPP
+#define RENDER_STATE_HPP
+
+// 跟踪的纹理单元数，更高的单元不做缓存、每次都调用GL
+#define RENDER_STATE_TEXTURE_UNITS 32
+// 为1时主循环每秒输出一次状态切换与省掉的次数
+#define RENDER_STATE_REPORT 0
+
+// 状态切换计数：issued为真正调用GL的次数，skipped为与当前状态相同而省掉的次数
+struct GLStateStats
+{
+    uint64_t programIssued = 0, programSkipped = 0;
+    uint64_t textureIssued = 0, textureSkipped = 0;
+    uint64_t vertexArrayIssued = 0, vertexArraySkipped = 0;
+};
+
+inline std::ostream &operator<<(std::ostream &os, const GLStateStats &stats)
+{
+    return os << "program " << stats.programIssued << "/" << stats.programSkipped
+              << ", texture " << stats.textureIssued << "/" << stats.textureSkipped
+              << ", VAO " << stats.vertexArrayIssued << "/" << stats.vertexArraySkipped
+              << " (issued/skipped)";
+}
+
+// 当前上下文的program、各单元的2D纹理与VAO，目标与当前相同时不调用GL，必须在主线程
+// 绑定都经由这里，绕过它直接修改这些状态后须调用invalidate()
+// 删除program/纹理/VAO也经由这里，GL会复用名字，否则新对象可能被误判为已绑定
+class GLStateCache
+{
+    GLuint program_;
+    GLuint vertexArray_;
+    GLuint textures_[RENDER_STATE_TEXTURE_UNITS];
+    GLStateStats stats_;
+
+private:
+    GLStateCache() : program_(0), vertexArray_(0), textures_{} {}
+    ~GLStateCache() = default;
+    GLStateCache(const GLStateCache &) = delete;
+    GLStateCache &operator=(const GLStateCache &) = delete;
+    GLStateCache(GLStateCache &&) = delete;
+    GLStateCache &operator=(GLStateCache &&) = delete;
+
+public:
+    static GLStateCache &getInstance()
+    {
+        static GLStateCache instance;
+        return instance;
+    }
+    void useProgram(GLuint program)
+    {
+        if (program == program_)
+        {
+            ++stats_.programSkipped;
+            return;
+        }
+        glUseProgram(program);
+        program_ = program;
+        ++stats_.programIssued;
+    }
+    // glBindTextureUnit，不改变活动纹理单元
+    void bindTexture(GLuint unit, GLuint texture)
+    {
+        if (unit >= RENDER_STATE_TEXTURE_UNITS)
+        {
+            glBindTextureUnit(unit, texture);
+            ++stats_.textureIssued;
+            return;
+        }
+        if (texture == textures_[unit])
+        {
+            ++stats_.textureSkipped;
+            return;
+        }
+        glBindTextureUnit(unit, texture);
+        textures_[unit] = texture;
+        ++stats_.textureIssued;
+    }
+    void bindVertexArray(GLuint vertexArray)
+    {
+        if (vertexArray == vertexArray_)
+        {
+            ++stats_.vertexArraySkipped;
+            return;
+        }
+        glBindVertexArray(vertexArray);
+        vertexArray_ = vertexArray;
+        ++stats_.vertexArrayIssued;
+    }
+    void deleteProgram(GLuint program)
+    {
+        if (0 == program)
+            return;
+        if (program == program_)
+            program_ = static_cast<GLuint>(-1); // 当前program在解除使用前仍然有效，状态记为未知
+        glDeleteProgram(program);
+    }
+    void deleteTexture(GLuint texture)
+    {
+        if (0 == texture)
+            return;
+        for (auto &bound : textures_)
+            if (bound == texture)
+                bound = 0; // 删除时GL已把它从所有单元解绑
+        glDeleteTextures(1, &texture);
+    }
+    void deleteVertexArray(GLuint vertexArray)
+    {
+        if (0 == vertexArray)
+            return;
+        if (vertexArray == vertexArray_)
+            vertexArray_ = 0; // 删除当前VAO时GL回到0
+        glDeleteVertexArrays(1, &vertexArray);
+    }
+    // 下一次绑定一定调用GL
+    void invalidate()
+    {
+        program_ = static_cast<GLuint>(-1);
+        vertexArray_ = static_cast<GLuint>(-1);
+        for (auto &bound : textures_)
+            bound = static_cast<GLuint>(-1);
+    }
+    const GLStateStats &getStats() const { return stats_; }
+    void resetStats() { stats_ = GLStateStats{}; }
+};
+
+#endif
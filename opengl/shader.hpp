@@ -1,17 +1,51 @@
 #include <string>
+#include <string_view>
+#include <vector>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <type_traits>
+#include <stdint.h>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "renderState.hpp"
 
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
+// uniform名的FNV-1a哈希，可在编译期求值；0保留给空槽位
+constexpr uint64_t uniformHash(std::string_view name)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (char c : name)
+    {
+        h ^= static_cast<uint8_t>(c);
+        h *= 1099511628211ull;
+    }
+    return 0 == h ? 1 : h;
+}
+
+// 类型化的uniform句柄，由Shader::uniform在初始化时查好，绘制时直接使用location
+template <class T>
+struct Uniform
+{
+    GLint location = -1; // -1时glUniform*静默忽略
+    bool valid() const { return location >= 0; }
+};
+
 class Shader
 {
+    // 链接后反射出的活跃uniform，开放寻址，容量为2的幂
+    struct UniformSlot
+    {
+        uint64_t hash = 0;
+        GLint location = -1;
+        GLenum type = 0;
+    };
+
     unsigned int ID_;
+    std::vector<UniformSlot> uniforms_;
 
 public:
     Shader(const std::filesystem::path &vertexPath, const std::filesystem::path &fragmentPath)
@@ -34,7 +68,9 @@ public:
             glGetProgramInfoLog(ID_, 1024, NULL, infoLog);
             std::cerr << "Failed to create shader program: " << infoLog << std::endl;
             glDeleteProgram(ID_);
+            return;
         }
+        reflectUniforms();
     }
     Shader(std::filesystem::path &vertexPath, std::filesystem::path &fragmentPath, std::filesystem::path &geometryPath)
     {
@@ -59,71 +95,169 @@ public:
             glGetProgramInfoLog(ID_, 1024, NULL, infoLog);
             std::cerr << "Failed to create shader program: " << infoLog << std::endl;
             glDeleteProgram(ID_);
+            return;
+        }
+        reflectUniforms();
+    }
+    // 计算着色器，用glDispatchCompute执行
+    explicit Shader(const std::filesystem::path &computePath)
+    {
+        unsigned int compute = compileShader(computePath, GL_COMPUTE_SHADER);
+        if (compute == 0)
+            return;
+        ID_ = glCreateProgram();
+        glAttachShader(ID_, compute);
+        glLinkProgram(ID_);
+        glDeleteShader(compute);
+        GLint success;
+        GLchar infoLog[1024];
+        glGetProgramiv(ID_, GL_LINK_STATUS, &success);
+        if (0 == success)
+        {
+            glGetProgramInfoLog(ID_, 1024, NULL, infoLog);
+            std::cerr << "Failed to create shader program: " << infoLog << std::endl;
+            glDeleteProgram(ID_);
+            return;
         }
+        reflectUniforms();
     }
-    ~Shader() { glDeleteProgram(ID_); }
+    ~Shader() { GLStateCache::getInstance().deleteProgram(ID_); }
     Shader(const Shader &) = delete;
     Shader &operator=(const Shader &) = delete;
-    Shader(Shader &&other) : ID_(other.ID_) { other.ID_ = 0; }
+    Shader(Shader &&other) : ID_(other.ID_), uniforms_(std::move(other.uniforms_)) { other.ID_ = 0; }
     Shader &operator=(Shader &&other)
     {
         if (this != &other)
             Shader(std::move(other)).swap(*this);
         return *this;
     }
-    void use() { glUseProgram(ID_); }
-    void setBool(const std::string &name, bool value) const
-    {
-        glUniform1i(glGetUniformLocation(ID_, name.c_str()), (int)value);
-    }
-    void setInt(const std::string &name, int value) const
-    {
-        glUniform1i(glGetUniformLocation(ID_, name.c_str()), value);
-    }
-    void setFloat(const std::string &name, float value) const
-    {
-        glUniform1f(glGetUniformLocation(ID_, name.c_str()), value);
-    }
-    void setVec2(const std::string &name, const glm::vec2 &value) const
-    {
-        glUniform2fv(glGetUniformLocation(ID_, name.c_str()), 1, &value[0]);
-    }
-    void setVec2(const std::string &name, float x, float y) const
-    {
-        glUniform2f(glGetUniformLocation(ID_, name.c_str()), x, y);
-    }
-    void setVec3(const std::string &name, const glm::vec3 &value) const
-    {
-        glUniform3fv(glGetUniformLocation(ID_, name.c_str()), 1, &value[0]);
-    }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    // 已在使用时不调用glUseProgram
+    void use() { GLStateCache::getInstance().useProgram(ID_); }
+    // 查找一次，之后用set(handle, value)设置；不存在或类型不符时返回无效句柄
+    template <class T>
+    Uniform<T> uniform(std::string_view name) const { return uniform<T>(uniformHash(name), name); }
+    template <class T>
+    Uniform<T> uniform(uint64_t hash, std::string_view name = {}) const
     {
-        glUniform3f(glGetUniformLocation(ID_, name.c_str()), x, y, z);
+        const UniformSlot *slot = findUniform(hash);
+        if (nullptr == slot)
+            return {};
+        if (!typeMatches<T>(slot->type))
+        {
+            std::cerr << "Uniform type mismatch: " << name << std::endl;
+            return {};
+        }
+        return {slot->location};
     }
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void set(Uniform<bool> u, bool value) const { glUniform1i(u.location, static_cast<int>(value)); }
+    void set(Uniform<int> u, int value) const { glUniform1i(u.location, value); }
+    void set(Uniform<float> u, float value) const { glUniform1f(u.location, value); }
+    void set(Uniform<glm::vec2> u, const glm::vec2 &value) const { glUniform2fv(u.location, 1, &value[0]); }
+    void set(Uniform<glm::vec3> u, const glm::vec3 &value) const { glUniform3fv(u.location, 1, &value[0]); }
+    void set(Uniform<glm::vec4> u, const glm::vec4 &value) const { glUniform4fv(u.location, 1, &value[0]); }
+    void set(Uniform<glm::mat2> u, const glm::mat2 &mat) const { glUniformMatrix2fv(u.location, 1, GL_FALSE, &mat[0][0]); }
+    void set(Uniform<glm::mat3> u, const glm::mat3 &mat) const { glUniformMatrix3fv(u.location, 1, GL_FALSE, &mat[0][0]); }
+    void set(Uniform<glm::mat4> u, const glm::mat4 &mat) const { glUniformMatrix4fv(u.location, 1, GL_FALSE, &mat[0][0]); }
+    // 按名字设置，只查反射表，不调用glGetUniformLocation
+    void setBool(std::string_view name, bool value) const { glUniform1i(location(name), static_cast<int>(value)); }
+    void setInt(std::string_view name, int value) const { glUniform1i(location(name), value); }
+    void setFloat(std::string_view name, float value) const { glUniform1f(location(name), value); }
+    void setVec2(std::string_view name, const glm::vec2 &value) const { glUniform2fv(location(name), 1, &value[0]); }
+    void setVec2(std::string_view name, float x, float y) const { glUniform2f(location(name), x, y); }
+    void setVec3(std::string_view name, const glm::vec3 &value) const { glUniform3fv(location(name), 1, &value[0]); }
+    void setVec3(std::string_view name, float x, float y, float z) const { glUniform3f(location(name), x, y, z); }
+    void setVec4(std::string_view name, const glm::vec4 &value) const { glUniform4fv(location(name), 1, &value[0]); }
+    void setVec4(std::string_view name, float x, float y, float z, float w) const { glUniform4f(location(name), x, y, z, w); }
+    void setMat2(std::string_view name, const glm::mat2 &mat) const { glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]); }
+    void setMat3(std::string_view name, const glm::mat3 &mat) const { glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]); }
+    void setMat4(std::string_view name, const glm::mat4 &mat) const { glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]); }
+    // 不存在时返回-1
+    GLint location(std::string_view name) const { return location(uniformHash(name)); }
+    GLint location(uint64_t hash) const
     {
-        glUniform4fv(glGetUniformLocation(ID_, name.c_str()), 1, &value[0]);
+        const UniformSlot *slot = findUniform(hash);
+        return nullptr == slot ? -1 : slot->location;
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) const
+    unsigned int getID() const { return ID_; }
+
+private:
+    void swap(Shader &other)
     {
-        glUniform4f(glGetUniformLocation(ID_, name.c_str()), x, y, z, w);
+        std::swap(ID_, other.ID_);
+        std::swap(uniforms_, other.uniforms_);
     }
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    // 链接成功后调用一次：枚举活跃uniform，uniform block中的成员没有location，跳过
+    void reflectUniforms()
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID_, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLint count = 0;
+        GLint maxLen = 0;
+        glGetProgramiv(ID_, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+        size_t capacity = 8;
+        while (capacity < 2 * static_cast<size_t>(count))
+            capacity <<= 1;
+        uniforms_.assign(capacity, UniformSlot{});
+        std::string name(maxLen > 0 ? maxLen : 1, '\0');
+        for (GLint i = 0; i < count; ++i)
+        {
+            GLsizei len = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID_, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &len, &size, &type, name.data());
+            std::string_view view(name.data(), len);
+            if (view.size() > 3 && view.ends_with("[0]")) // 数组以不带下标的名字查找
+                view.remove_suffix(3);
+            GLint loc = glGetUniformLocation(ID_, name.c_str());
+            if (loc < 0)
+                continue;
+            uint64_t hash = uniformHash(view);
+            size_t mask = uniforms_.size() - 1;
+            size_t idx = hash & mask;
+            while (0 != uniforms_[idx].hash && hash != uniforms_[idx].hash)
+                idx = (idx + 1) & mask;
+            if (hash == uniforms_[idx].hash)
+                std::cerr << "Uniform name hash collision: " << view << std::endl;
+            uniforms_[idx] = {hash, loc, type};
+        }
     }
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    const UniformSlot *findUniform(uint64_t hash) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID_, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        if (uniforms_.empty())
+            return nullptr;
+        size_t mask = uniforms_.size() - 1;
+        for (size_t idx = hash & mask;; idx = (idx + 1) & mask)
+        {
+            if (hash == uniforms_[idx].hash)
+                return &uniforms_[idx];
+            if (0 == uniforms_[idx].hash)
+                return nullptr;
+        }
     }
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    template <class T>
+    static bool typeMatches(GLenum type)
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID_, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        if constexpr (std::is_same_v<T, bool>)
+            return GL_BOOL == type;
+        else if constexpr (std::is_same_v<T, int>) // 采样器同样用glUniform1i设置纹理单元
+            return GL_INT == type || GL_SAMPLER_2D == type || GL_SAMPLER_3D == type || GL_SAMPLER_CUBE == type ||
+                   GL_SAMPLER_2D_SHADOW == type || GL_SAMPLER_2D_ARRAY == type;
+        else if constexpr (std::is_same_v<T, float>)
+            return GL_FLOAT == type;
+        else if constexpr (std::is_same_v<T, glm::vec2>)
+            return GL_FLOAT_VEC2 == type;
+        else if constexpr (std::is_same_v<T, glm::vec3>)
+            return GL_FLOAT_VEC3 == type;
+        else if constexpr (std::is_same_v<T, glm::vec4>)
+            return GL_FLOAT_VEC4 == type;
+        else if constexpr (std::is_same_v<T, glm::mat2>)
+            return GL_FLOAT_MAT2 == type;
+        else if constexpr (std::is_same_v<T, glm::mat3>)
+            return GL_FLOAT_MAT3 == type;
+        else if constexpr (std::is_same_v<T, glm::mat4>)
+            return GL_FLOAT_MAT4 == type;
+        else
+            static_assert(sizeof(T) == 0, "unsupported uniform type");
     }
-    unsigned int getID() const { return ID_; }
-
-private:
-    void swap(Shader &other) { std::swap(ID_, other.ID_); }
     unsigned int compileShader(const std::filesystem::path &path, GLenum shaderType)
     {
         std::ifstream file(path, std::ios::binary);
@@ -0,0 +1,280 @@
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef VERTEX_CACHE_HPP
+#define VERTEX_CACHE_HPP
+
+// Forsyth算法模拟的LRU缓存大小
+#define VCACHE_LRU_SIZE 32
+// ACMR统计时模拟的FIFO后变换缓存大小
+#define VCACHE_FIFO_SIZE 16
+
+// 模型加载时的索引与顶点重排，只改变顺序，不改变几何：
+//   optimizeCache     Forsyth线性时间顶点缓存优化
+//   optimizeOverdraw  以缓存重置点切分成簇，外侧朝向的簇先画，减少overdraw
+//   optimizeFetch     顶点按首次使用的顺序重排，顺序读取顶点缓冲
+// 顶点类型只需有position.x/y/z
+class VertexCache
+{
+public:
+    // 依次执行上面三步
+    template <class V>
+    static void optimizeMesh(std::vector<V> &vertices, std::vector<unsigned int> &indices)
+    {
+        optimizeCache(indices, vertices.size());
+        optimizeOverdraw(vertices, indices);
+        optimizeFetch(vertices, indices);
+    }
+    // 平均每个三角形的缓存未命中数，理想值约0.5，最差为3
+    static double acmr(const std::vector<unsigned int> &indices, size_t vertexNum, unsigned int cacheSize = VCACHE_FIFO_SIZE)
+    {
+        size_t triNum = indices.size() / 3;
+        return 0 == triNum ? 0.0 : static_cast<double>(fifoMisses(indices, vertexNum, cacheSize)) / triNum;
+    }
+    // 每个顶点的平均变换次数，理想值为1
+    static double atvr(const std::vector<unsigned int> &indices, size_t vertexNum, unsigned int cacheSize = VCACHE_FIFO_SIZE)
+    {
+        return 0 == vertexNum ? 0.0 : static_cast<double>(fifoMisses(indices, vertexNum, cacheSize)) / vertexNum;
+    }
+    // 索引越界时不做任何修改
+    static void optimizeCache(std::vector<unsigned int> &indices, size_t vertexNum)
+    {
+        const size_t triNum = indices.size() / 3;
+        if (0 == triNum || !inRange(indices, vertexNum))
+            return;
+        // 每个顶点尚未输出的相邻三角形，adjacency中[first[v], first[v] + remaining[v])有效
+        std::vector<uint32_t> first(vertexNum + 1, 0);
+        std::vector<uint32_t> remaining(vertexNum, 0);
+        for (size_t i = 0; i < triNum * 3; ++i)
+            ++remaining[indices[i]];
+        for (size_t v = 0; v < vertexNum; ++v)
+            first[v + 1] = first[v] + remaining[v];
+        std::vector<uint32_t> adjacency(triNum * 3);
+        {
+            std::vector<uint32_t> cursor(first.begin(), first.end() - 1);
+            for (size_t i = 0; i < triNum * 3; ++i)
+                adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+        std::vector<int32_t> cachePos(vertexNum, -1);
+        std::vector<float> vertexScore(vertexNum);
+        for (size_t v = 0; v < vertexNum; ++v)
+            vertexScore[v] = score(-1, remaining[v]);
+        std::vector<uint8_t> emitted(triNum, 0);
+
+        std::vector<unsigned int> out;
+        out.reserve(triNum * 3);
+        uint32_t cache[VCACHE_LRU_SIZE + 3];
+        uint32_t nextCache[VCACHE_LRU_SIZE + 3];
+        int cacheLen = 0;
+        int64_t best = -1;
+        size_t cursor = 0; // 缓存里没有候选时，按输入顺序取下一个未输出的三角形
+        for (size_t n = 0; n < triNum; ++n)
+        {
+            if (best < 0)
+            {
+                while (emitted[cursor])
+                    ++cursor;
+                best = static_cast<int64_t>(cursor);
+            }
+            const uint32_t t = static_cast<uint32_t>(best);
+            emitted[t] = 1;
+            int nextLen = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t v = indices[3 * t + k];
+                out.push_back(v);
+                nextCache[nextLen++] = v;
+                uint32_t *adj = adjacency.data() + first[v]; // 从v的邻接表中移除t
+                for (uint32_t j = 0; j < remaining[v]; ++j)
+                    if (adj[j] == t)
+                    {
+                        adj[j] = adj[--remaining[v]];
+                        break;
+                    }
+            }
+            for (int i = 0; i < cacheLen; ++i)
+                if (cache[i] != nextCache[0] && cache[i] != nextCache[1] && cache[i] != nextCache[2])
+                    nextCache[nextLen++] = cache[i];
+            // 更新缓存中（及刚被挤出的）顶点的得分，候选为它们尚未输出的相邻三角形
+            for (int i = 0; i < nextLen; ++i)
+            {
+                uint32_t v = nextCache[i];
+                cachePos[v] = i < VCACHE_LRU_SIZE ? i : -1;
+                vertexScore[v] = score(cachePos[v], remaining[v]);
+            }
+            best = -1;
+            float bestScore = -1.0f;
+            for (int i = 0; i < nextLen; ++i)
+            {
+                uint32_t v = nextCache[i];
+                for (uint32_t j = 0; j < remaining[v]; ++j)
+                {
+                    uint32_t adjTri = adjacency[first[v] + j];
+                    float s = vertexScore[indices[3 * adjTri]] + vertexScore[indices[3 * adjTri + 1]] + vertexScore[indices[3 * adjTri + 2]];
+                    if (s > bestScore)
+                    {
+                        bestScore = s;
+                        best = adjTri;
+                    }
+                }
+            }
+            cacheLen = std::min(nextLen, VCACHE_LRU_SIZE);
+            std::copy(nextCache, nextCache + cacheLen, cache);
+        }
+        indices.swap(out);
+    }
+    // 须在optimizeCache之后调用：每个三个顶点都未命中的三角形开始一个新簇，簇内顺序不变
+    // 簇按 (簇中心 - 网格中心)·簇平均法线 从大到小排列，靠外、朝外的面先画，后画的被遮挡部分可被深度测试提前剔除
+    template <class V>
+    static void optimizeOverdraw(const std::vector<V> &vertices, std::vector<unsigned int> &indices)
+    {
+        const size_t triNum = indices.size() / 3;
+        if (triNum < 2 || !inRange(indices, vertices.size()))
+            return;
+        std::vector<size_t> starts;
+        {
+            std::vector<uint32_t> stamp(vertices.size(), 0); // 同fifoMisses
+            uint32_t time = 0;
+            for (size_t t = 0; t < triNum; ++t)
+            {
+                int misses = 0;
+                for (int k = 0; k < 3; ++k)
+                {
+                    uint32_t v = indices[3 * t + k];
+                    if (0 != stamp[v] && time - stamp[v] < VCACHE_FIFO_SIZE)
+                        continue;
+                    ++misses;
+                    stamp[v] = ++time;
+                }
+                if (3 == misses)
+                    starts.push_back(t);
+            }
+        }
+        if (starts.size() < 2)
+            return;
+        float center[3] = {0.0f, 0.0f, 0.0f};
+        for (auto &v : vertices)
+        {
+            center[0] += v.position.x;
+            center[1] += v.position.y;
+            center[2] += v.position.z;
+        }
+        for (float &c : center)
+            c /= static_cast<float>(vertices.size());
+        struct Cluster
+        {
+            size_t begin, end;
+            float key;
+        };
+        std::vector<Cluster> clusters;
+        clusters.reserve(starts.size());
+        for (size_t c = 0; c < starts.size(); ++c)
+        {
+            Cluster cluster{starts[c], c + 1 < starts.size() ? starts[c + 1] : triNum, 0.0f};
+            float centroid[3] = {0.0f, 0.0f, 0.0f};
+            float normal[3] = {0.0f, 0.0f, 0.0f};
+            float area = 0.0f;
+            for (size_t t = cluster.begin; t < cluster.end; ++t)
+            {
+                auto &a = vertices[indices[3 * t]].position;
+                auto &b = vertices[indices[3 * t + 1]].position;
+                auto &d = vertices[indices[3 * t + 2]].position;
+                float e1[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+                float e2[3] = {d.x - a.x, d.y - a.y, d.z - a.z};
+                float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+                float w = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]); // 两倍面积，作为权重
+                centroid[0] += (a.x + b.x + d.x) * w;
+                centroid[1] += (a.y + b.y + d.y) * w;
+                centroid[2] += (a.z + b.z + d.z) * w;
+                normal[0] += n[0];
+                normal[1] += n[1];
+                normal[2] += n[2];
+                area += w;
+            }
+            float len = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            if (area > 0.0f && len > 0.0f)
+                for (int k = 0; k < 3; ++k)
+                    cluster.key += (centroid[k] / (3.0f * area) - center[k]) * normal[k] / len;
+            clusters.push_back(cluster);
+        }
+        std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &l, const Cluster &r)
+                         { return l.key > r.key; });
+        std::vector<unsigned int> out;
+        out.reserve(indices.size());
+        for (auto &cluster : clusters)
+            out.insert(out.end(), indices.begin() + 3 * cluster.begin, indices.begin() + 3 * cluster.end);
+        indices.swap(out);
+    }
+    // 未被引用的顶点保留在末尾（CPU侧可能仍会读取）
+    template <class V>
+    static void optimizeFetch(std::vector<V> &vertices, std::vector<unsigned int> &indices)
+    {
+        if (!inRange(indices, vertices.size()))
+            return;
+        std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+        uint32_t next = 0;
+        for (auto &index : indices)
+        {
+            if (UINT32_MAX == remap[index])
+                remap[index] = next++;
+            index = remap[index];
+        }
+        for (auto &r : remap)
+            if (UINT32_MAX == r)
+                r = next++;
+        std::vector<V> out(vertices.size());
+        for (size_t v = 0; v < vertices.size(); ++v)
+            out[remap[v]] = std::move(vertices[v]);
+        vertices.swap(out);
+    }
+
+private:
+    static bool inRange(const std::vector<unsigned int> &indices, size_t vertexNum)
+    {
+        for (auto index : indices)
+            if (index >= vertexNum)
+                return false;
+        return true;
+    }
+    // Forsyth的顶点得分：刚用过的三个顶点固定0.75，之后按缓存位置衰减；剩余相邻三角形越少得分越高，尽快用完
+    static float score(int cachePos, uint32_t remaining)
+    {
+        static const struct Table
+        {
+            float cache[VCACHE_LRU_SIZE];
+            float valence[64];
+            Table()
+            {
+                for (int i = 0; i < VCACHE_LRU_SIZE; ++i)
+                    cache[i] = i < 3 ? 0.75f : powf(1.0f - static_cast<float>(i - 3) / (VCACHE_LRU_SIZE - 3), 1.5f);
+                for (int i = 0; i < 64; ++i)
+                    valence[i] = 0 == i ? 0.0f : 2.0f * powf(static_cast<float>(i), -0.5f);
+            }
+        } table;
+        if (0 == remaining)
+            return -1.0f;
+        float s = cachePos >= 0 ? table.cache[cachePos] : 0.0f;
+        return s + (remaining < 64 ? table.valence[remaining] : 2.0f * powf(static_cast<float>(remaining), -0.5f));
+    }
+    static size_t fifoMisses(const std::vector<unsigned int> &indices, size_t vertexNum, unsigned int cacheSize)
+    {
+        std::vector<size_t> stamp(vertexNum, 0); // 进入FIFO时的序号，0表示从未进入
+        size_t time = 0;
+        size_t misses = 0;
+        for (auto index : indices)
+        {
+            if (index >= vertexNum)
+                continue;
+            if (0 != stamp[index] && time - stamp[index] < cacheSize)
+                continue;
+            stamp[index] = ++time;
+            ++misses;
+        }
+        return misses;
+    }
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <glm/glm.hpp>
+#ifndef BBG_HEADLESS
+#include <glad/glad.h>
+#endif
+
+#ifndef VERTEX_FORMAT_HPP
+#define VERTEX_FORMAT_HPP
+
+#define MAX_BONE_INFLUENCE 4
+// 实例化绘制时每实例模型矩阵的起始attribute location，占用连续4个（mat4按列）
+#define INSTANCE_MATRIX_LOCATION 7
+// 压缩格式中表示没有骨骼的索引
+#define SKIN_NO_BONE 0xFFFF
+
+// 导入时的完整顶点，只留在CPU侧（碰撞检测等直接读取），上传GPU时转换为下面的紧凑格式
+struct Vertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoords;
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
+    int boneIDs[MAX_BONE_INFLUENCE];
+    float weights[MAX_BONE_INFLUENCE];
+};
+
+// 紧凑格式的编码，着色器中的解码见glsl的octDecode
+struct VertexPacking
+{
+    // 四舍五入到最近偶数，溢出为无穷
+    static uint16_t toHalf(float f)
+    {
+        uint32_t x;
+        memcpy(&x, &f, 4);
+        uint32_t sign = (x >> 16) & 0x8000;
+        uint32_t biased = (x >> 23) & 0xFF;
+        uint32_t mant = x & 0x7FFFFF;
+        if (0xFF == biased)
+            return static_cast<uint16_t>(sign | 0x7C00 | (mant ? 0x200 : 0));
+        int32_t exp = static_cast<int32_t>(biased) - 127 + 15;
+        if (exp >= 31)
+            return static_cast<uint16_t>(sign | 0x7C00);
+        uint32_t shift = 13;
+        if (exp <= 0) // 非规格化数
+        {
+            if (exp < -10)
+                return static_cast<uint16_t>(sign);
+            mant |= 0x800000;
+            shift = 14 - exp;
+            exp = 0;
+        }
+        uint32_t h = (static_cast<uint32_t>(exp) << 10) | (mant >> shift);
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1)))
+            ++h; // 进位到指数位仍然正确
+        return static_cast<uint16_t>(sign | h);
+    }
+    // 单位向量的八面体映射，结果在[-1, 1]^2
+    static glm::vec2 octEncode(const glm::vec3 &n)
+    {
+        float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+        if (l1 <= 0.0f)
+            return glm::vec2{0.0f, 0.0f};
+        float x = n.x / l1;
+        float y = n.y / l1;
+        if (n.z < 0.0f)
+        {
+            float ox = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float oy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = ox;
+            y = oy;
+        }
+        return glm::vec2{x, y};
+    }
+    static int16_t snorm16(float v) { return static_cast<int16_t>(lrintf(fminf(fmaxf(v, -1.0f), 1.0f) * 32767.0f)); }
+    static int8_t snorm8(float v) { return static_cast<int8_t>(lrintf(fminf(fmaxf(v, -1.0f), 1.0f) * 127.0f)); }
+    // 有效的权重归一化后量化，和为255，舍入误差补到最大的一项上
+    static void unorm8Weights(const Vertex &v, uint8_t out[MAX_BONE_INFLUENCE])
+    {
+        float total = 0.0f;
+        for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
+            if (v.boneIDs[i] >= 0)
+                total += fmaxf(v.weights[i], 0.0f);
+        int sum = 0;
+        int largest = 0;
+        for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
+        {
+            float w = v.boneIDs[i] < 0 || total <= 0.0f ? 0.0f : fmaxf(v.weights[i], 0.0f) / total;
+            out[i] = static_cast<uint8_t>(lrintf(w * 255.0f));
+            sum += out[i];
+            if (out[i] > out[largest])
+                largest = i;
+        }
+        if (sum > 0)
+            out[largest] = static_cast<uint8_t>(out[largest] + 255 - sum);
+    }
+};
+
+// 静态网格，24字节（Vertex为88字节）
+// location: 0位置 1法线(八面体snorm16) 2纹理坐标(half) 3切线(八面体snorm8，z为副切线符号)
+struct StaticVertex
+{
+    glm::vec3 position;
+    int16_t normal[2];
+    uint16_t texCoords[2];
+    int8_t tangent[4];
+
+    static StaticVertex pack(const Vertex &v)
+    {
+        StaticVertex out;
+        out.position = v.position;
+        glm::vec2 n = VertexPacking::octEncode(v.normal);
+        out.normal[0] = VertexPacking::snorm16(n.x);
+        out.normal[1] = VertexPacking::snorm16(n.y);
+        out.texCoords[0] = VertexPacking::toHalf(v.texCoords.x);
+        out.texCoords[1] = VertexPacking::toHalf(v.texCoords.y);
+        glm::vec2 t = VertexPacking::octEncode(v.tangent);
+        glm::vec3 c{v.normal.y * v.tangent.z - v.normal.z * v.tangent.y,
+                    v.normal.z * v.tangent.x - v.normal.x * v.tangent.z,
+                    v.normal.x * v.tangent.y - v.normal.y * v.tangent.x};
+        float handedness = c.x * v.bitangent.x + c.y * v.bitangent.y + c.z * v.bitangent.z;
+        out.tangent[0] = VertexPacking::snorm8(t.x);
+        out.tangent[1] = VertexPacking::snorm8(t.y);
+        out.tangent[2] = handedness < 0.0f ? -127 : 127;
+        out.tangent[3] = 0;
+        return out;
+    }
+#ifndef BBG_HEADLESS
+    // 在已绑定的VAO上按当前GL_ARRAY_BUFFER设置attribute
+    static void setupAttributes() { setupCommonAttributes(sizeof(StaticVertex)); }
+    // 与SkinnedVertex共用前缀布局
+    static void setupCommonAttributes(GLsizei stride)
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)offsetof(StaticVertex, position));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void *)offsetof(StaticVertex, normal));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void *)offsetof(StaticVertex, texCoords));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(3, 4, GL_BYTE, GL_TRUE, stride, (void *)offsetof(StaticVertex, tangent));
+        glEnableVertexAttribArray(3);
+    }
+#endif
+};
+static_assert(sizeof(StaticVertex) == 24, "StaticVertex must stay tightly packed");
+
+// 蒙皮网格，36字节：StaticVertex + 4个uint16骨骼索引 + 4个unorm8权重
+// 骨骼索引是Model中节点表的下标（包含非骨骼节点），可能超过255，因此用16位
+// location: 0~3同StaticVertex 5骨骼索引(uvec4，SKIN_NO_BONE表示无) 6权重
+struct SkinnedVertex
+{
+    StaticVertex base;
+    uint16_t boneIDs[MAX_BONE_INFLUENCE];
+    uint8_t weights[MAX_BONE_INFLUENCE];
+
+    // rt: 索引超出16位的影响被丢弃时overflow置为true
+    static SkinnedVertex pack(const Vertex &v, bool &overflow)
+    {
+        SkinnedVertex out;
+        out.base = StaticVertex::pack(v);
+        Vertex kept = v;
+        for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
+        {
+            if (kept.boneIDs[i] >= SKIN_NO_BONE)
+            {
+                overflow = true;
+                kept.boneIDs[i] = -1;
+            }
+            out.boneIDs[i] = kept.boneIDs[i] < 0 ? SKIN_NO_BONE : static_cast<uint16_t>(kept.boneIDs[i]);
+        }
+        VertexPacking::unorm8Weights(kept, out.weights);
+        return out;
+    }
+#ifndef BBG_HEADLESS
+    static void setupAttributes()
+    {
+        StaticVertex::setupCommonAttributes(sizeof(SkinnedVertex));
+        glVertexAttribIPointer(5, MAX_BONE_INFLUENCE, GL_UNSIGNED_SHORT, sizeof(SkinnedVertex), (void *)offsetof(SkinnedVertex, boneIDs));
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(6, MAX_BONE_INFLUENCE, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinnedVertex), (void *)offsetof(SkinnedVertex, weights));
+        glEnableVertexAttribArray(6);
+    }
+#endif
+};
+static_assert(sizeof(SkinnedVertex) == 36, "SkinnedVertex must stay tightly packed");
+
+#ifndef BBG_HEADLESS
+// 在已绑定的VAO上把当前GL_ARRAY_BUFFER（紧密排列的glm::mat4）设为每实例模型矩阵
+inline void setupInstanceAttributes()
+{
+    for (GLuint i = 0; i < 4; ++i)
+    {
+        glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *)(i * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + i);
+        glVertexAttribDivisor(INSTANCE_MATRIX_LOCATION + i, 1);
+    }
+}
+#endif
+
+#endif
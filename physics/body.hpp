@@ -0,0 +1,153 @@
+#include <utility>
+#include <glm/glm.hpp>
+#include "movement.hpp"
+
+#ifndef BODY_HPP
+#define BODY_HPP
+
+#define BODY_POS_MOVE_SENSITIVITY 5.0f
+
+// 可移动刚体的纯CPU状态（位置、朝向、下落时间），不依赖模型与GL，服务端与客户端共用同一套移动代码
+class Body
+{
+    bool isMoved_;
+    float moveSensitivity_;
+    float fallTime_; // 自由下落已持续的时间，-1表示未在下落
+    glm::vec3 position_;
+    glm::vec3 front_;
+    glm::vec3 up_;
+    glm::vec3 right_;
+
+public:
+    Body(float x = 0.0f, float y = 0.0f, float height = 0.0f)
+        : isMoved_(false),
+          moveSensitivity_(BODY_POS_MOVE_SENSITIVITY),
+          fallTime_(-1.0f),
+          position_(x, height, y),
+          front_(0.0f, 0.0f, -1.0f),
+          up_(0.0f, 1.0f, 0.0f),
+          right_(1.0f, 0.0f, 0.0f) {}
+    Body(const glm::mat4 &globalMat)
+        : isMoved_(false),
+          moveSensitivity_(BODY_POS_MOVE_SENSITIVITY),
+          fallTime_(-1.0f),
+          position_(glm::vec3(globalMat[3][0], globalMat[3][1], globalMat[3][2])),
+          front_(0.0f, 0.0f, -1.0f),
+          up_(0.0f, 1.0f, 0.0f),
+          right_(1.0f, 0.0f, 0.0f) {}
+    ~Body() = default;
+    Body(const Body &) = default;
+    Body &operator=(const Body &) = default;
+    Body(Body &&other)
+        : isMoved_(other.isMoved_),
+          moveSensitivity_(other.moveSensitivity_),
+          fallTime_(other.fallTime_),
+          position_(other.position_),
+          front_(other.front_),
+          up_(other.up_),
+          right_(other.right_)
+    {
+        other.isMoved_ = false;
+        other.moveSensitivity_ = 0.0f;
+        other.fallTime_ = -1.0f;
+        other.position_ = glm::vec3(0.0f);
+        other.front_ = glm::vec3(0.0f);
+        other.up_ = glm::vec3(0.0f);
+        other.right_ = glm::vec3(0.0f);
+    }
+    Body &operator=(Body &&other)
+    {
+        if (this != &other)
+            Body(std::move(other)).swap(*this);
+        return *this;
+    }
+    bool isMoved() const { return isMoved_; }
+    void setMoved() { isMoved_ = true; }
+    void clearMoved() { isMoved_ = false; }
+    float &getFallTime() { return fallTime_; }
+    glm::vec3 &getPosition() { return position_; }
+    const glm::vec3 &getPosition() const { return position_; }
+    const glm::vec3 &getFront() const { return front_; }
+    const glm::vec3 &getUp() const { return up_; }
+    const glm::vec3 &getRight() const { return right_; }
+    glm::mat4 getGlobalMat() const
+    {
+        return glm::mat4(
+            glm::vec4(right_, 0.0f),
+            glm::vec4(up_, 0.0f),
+            glm::vec4(front_, 0.0f),
+            glm::vec4(position_.x, position_.y, position_.z, 1.0f));
+    }
+    // globalMat为视图矩阵（Player::getGlobalMat），取其旋转部分的各行作为朝向
+    void setViewMove(const glm::mat4 &globalMat)
+    {
+        front_.x = globalMat[0][2];
+        front_.y = globalMat[1][2];
+        front_.z = globalMat[2][2];
+        up_.x = globalMat[0][1];
+        up_.y = globalMat[1][1];
+        up_.z = globalMat[2][1];
+        right_.x = globalMat[0][0];
+        right_.y = globalMat[1][0];
+        right_.z = globalMat[2][0];
+    }
+    void setView(const glm::vec3 &front, const glm::vec3 &up, const glm::vec3 &right)
+    {
+        front_ = front;
+        up_ = up;
+        right_ = right;
+    }
+    void processPosMove(Movement direction, float deltaTime)
+    {
+        float rate = moveSensitivity_ * deltaTime;
+        glm::vec3 final(0.0f, 0.0f, 0.0f);
+        switch (direction)
+        {
+        case Movement::FORWARD:
+            final.x = front_.x;
+            final.z = front_.z;
+            position_ += final * rate;
+            break;
+        case Movement::BACKWARD:
+            final.x = front_.x;
+            final.z = front_.z;
+            position_ -= final * rate;
+            break;
+        case Movement::LEFT:
+            final.x = right_.x;
+            final.z = right_.z;
+            position_ -= final * rate;
+            break;
+        case Movement::RIGHT:
+            final.x = right_.x;
+            final.z = right_.z;
+            position_ += final * rate;
+            break;
+        case Movement::UP:
+            final.y = 1.0f;
+            position_ += final * rate;
+            break;
+        case Movement::DOWN:
+            final.y = 1.0f;
+            position_ -= final * rate;
+            break;
+        default:
+            break;
+        }
+        isMoved_ = true;
+    }
+
+protected:
+    void swap(Body &other)
+    {
+        std::swap(isMoved_, other.isMoved_);
+        std::swap(moveSensitivity_, other.moveSensitivity_);
+        std::swap(fallTime_, other.fallTime_);
+        std::swap(position_, other.position_);
+        std::swap(front_, other.front_);
+        std::swap(up_, other.up_);
+        std::swap(right_, other.right_);
+    }
+};
+
+#endif
@@ -13,7 +13,6 @@ class Ground : public Model
 {
     std::unordered_map<std::string, Collider> colliders_;
     float half_g_ = GRAVITY_ACCELERATION * 0.5f;
-    float sumTime_ = -1.0f;
 
 public:
     Ground(const std::filesystem::path &path)
@@ -43,59 +42,63 @@ public:
     }
     void detectNcorrect(float deltaTime)
     {
-        Mesh &groundMesh = getMeshes()[0]; // 默认第一个Mesh为地面！！！
-        // 处理某个Collider与地面Mesh的碰撞
         for (auto &collider : colliders_)
         {
-            if (collider.second.isMoved())
+            detectNcorrect(collider.second, deltaTime);
+            // 处理Collider之间的碰撞
+            /////////////////////////////////////////////////////////
+        }
+    }
+    // 处理某个Body与地面Mesh的碰撞，服务端对每个玩家的Body逐一调用
+    void detectNcorrect(Body &body, float deltaTime)
+    {
+        if (!body.isMoved())
+            return;
+        Mesh &groundMesh = getMeshes()[0]; // 默认第一个Mesh为地面！！！
+        //////// octree later... ////////
+        //  重力模拟
+        glm::vec3 down(0.0f, -1.0f, 0.0f);
+        float &sumTime = body.getFallTime();
+        for (int i = 0; i < groundMesh.getIndices().size(); i += 3)
+        {
+            auto &v0 = groundMesh.getVertices()[groundMesh.getIndices()[i]];
+            auto &v1 = groundMesh.getVertices()[groundMesh.getIndices()[i + 1]];
+            auto &v2 = groundMesh.getVertices()[groundMesh.getIndices()[i + 2]];
+            glm::vec2 intersection;
+            float distance = .0f;
+            if (glm::intersectRayTriangle(body.getPosition(),
+                                          down,
+                                          v0.position,
+                                          v1.position,
+                                          v2.position,
+                                          intersection,
+                                          distance) &&
+                (distance > .01f || distance < -.01f))
             {
-                //////// octree later... ////////
-                //  重力模拟
-                glm::vec3 down(0.0f, -1.0f, 0.0f);
-                for (int i = 0; i < groundMesh.getIndices().size(); i += 3)
-                {
-                    auto &v0 = groundMesh.getVertices()[groundMesh.getIndices()[i]];
-                    auto &v1 = groundMesh.getVertices()[groundMesh.getIndices()[i + 1]];
-                    auto &v2 = groundMesh.getVertices()[groundMesh.getIndices()[i + 2]];
-                    glm::vec2 intersection;
-                    float distance = .0f;
-                    if (glm::intersectRayTriangle(collider.second.getPosition(),
-                                                  down,
-                                                  v0.position,
-                                                  v1.position,
-                                                  v2.position,
-                                                  intersection,
-                                                  distance) &&
-                        (distance > .01f || distance < -.01f))
+                // ///////////////////////////////////////////////////////////
+                // std::clog << body.getPosition().y << std::endl;
+                // ///////////////////////////////////////////////////////////
+                if (-1.0f == sumTime)
+                    sumTime = 0.0f;
+                else
+                { // d = 1/2 * g_ * ( t^2 - t0^2 )
+                    float t0_square = sumTime * sumTime;
+                    sumTime += deltaTime;
+                    float t_square = sumTime * sumTime;
+                    float d = half_g_ * (t_square - t0_square);
+                    body.getPosition().y -= d;
+                    if (body.getPosition().y < 0.01f)
                     {
-                        // ///////////////////////////////////////////////////////////
-                        // std::clog << collider.second.getPosition().y << std::endl;
-                        // ///////////////////////////////////////////////////////////
-                        if (-1.0f == sumTime_)
-                            sumTime_ = 0.0f;
-                        else
-                        { // d = 1/2 * g_ * ( t^2 - t0^2 )
-                            float t0_square = sumTime_ * sumTime_;
-                            sumTime_ += deltaTime;
-                            float t_square = sumTime_ * sumTime_;
-                            float d = half_g_ * (t_square - t0_square);
-                            collider.second.getPosition().y -= d;
-                            if (collider.second.getPosition().y < 0.01f)
-                            {
-                                sumTime_ = -1.0;
-                                collider.second.getPosition().y -= distance;
-                                collider.second.clearMoved();
-                            }
-                        }
-                        break;
+                        sumTime = -1.0;
+                        body.getPosition().y -= distance;
+                        body.clearMoved();
                     }
                 }
-                // 处理与地面中其他Mesh的碰撞
-                /////////////////////////////////////////////////////////
+                break;
             }
-            // 处理Collider之间的碰撞
-            /////////////////////////////////////////////////////////
         }
+        // 处理与地面中其他Mesh的碰撞
+        /////////////////////////////////////////////////////////
     }
 };
 